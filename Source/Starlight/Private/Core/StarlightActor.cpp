@@ -4,14 +4,16 @@
 #include "Core/StarlightActor.h"
 
 #include "Core/StarlightConstants.h"
-#include "Grab/GrabConstants.h"
 #include "Portal/TeleportableCopy.h"
 #include "Portal/Portal.h"
+#include "Portal/PortalStatics.h"
 #include "Portal/StaticTeleportableCopy.h"
 
 AStarlightActor::AStarlightActor()
 {
 	PrimaryActorTick.bCanEverTick = true;
+	// cull plane follows overlapping portals, which tick post physics
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
 	
 	MeshComponent = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("StaticMeshComponent"));
 	MeshComponent->SetSimulatePhysics(true);
@@ -19,6 +21,8 @@ AStarlightActor::AStarlightActor()
 	MeshComponent->SetCollisionObjectType(ECC_PhysicsBody);
 	MeshComponent->SetCollisionResponseToChannel(ECC_Portal, ECR_Ignore);
 	MeshComponent->SetCollisionResponseToChannel(ECC_GrabObstruction, ECR_Ignore);
+	// copies are ignored by default so only bodies which should be pushed by them block them
+	MeshComponent->SetCollisionResponseToChannel(ECC_PortalCopy, ECR_Block);
 	RootComponent = MeshComponent;
 }
 
@@ -36,7 +40,6 @@ void AStarlightActor::OnGrab()
 void AStarlightActor::OnRelease()
 {
 	IGrabbable::OnRelease();
-	MeshComponent->SetPhysicsLinearVelocity(MeshComponent->GetPhysicsLinearVelocity() * GrabConstants::ReleaseLinearVelocityMultiplier);
 	bIsGrabbed = false;
 }
 
@@ -45,16 +48,12 @@ bool AStarlightActor::IsGrabbed() const
 	return bIsGrabbed;
 }
 
-void AStarlightActor::OnGrabbableMoved(const float Speed)
-{
-	GrabbedMovementSpeed = Speed;
-}
-
 void AStarlightActor::OnOverlapWithPortalBegin(TObjectPtr<APortal> Portal)
 {
 	ITeleportable::OnOverlapWithPortalBegin(Portal);
 
 	OverlappingPortals.Add(Portal);
+	AddTickPrerequisiteActor(Portal);
 	UpdateMaterialParameters();
 }
 
@@ -63,6 +62,7 @@ void AStarlightActor::OnOverlapWithPortalEnd(TObjectPtr<APortal> Portal)
 	ITeleportable::OnOverlapWithPortalEnd(Portal);
 
 	OverlappingPortals.Remove(Portal);
+	RemoveTickPrerequisiteActor(Portal);
 	UpdateMaterialParameters();
 }
 
@@ -70,7 +70,8 @@ void AStarlightActor::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
-	if (OverlappingPortals.Num() > 1)
+	// material instance only sends parameters which have changed, so it's cheap to keep up with moving portals
+	if (OverlappingPortals.Num() > 0)
 	{
 		UpdateMaterialParameters();
 	}
@@ -85,7 +86,8 @@ void AStarlightActor::BeginPlay()
 {
 	Super::BeginPlay();
 
-	DynamicMaterialInstance = MeshComponent->CreateDynamicMaterialInstance(0);
+	UPortalStatics::CreateCullPlaneMaterial(MeshComponent);
+	UPortalStatics::ClearCullPlane(MeshComponent);
 }
 
 TObjectPtr<UPrimitiveComponent> AStarlightActor::GetCollisionComponent() const
@@ -105,31 +107,12 @@ void AStarlightActor::SetTeleportVelocity(const FVector& LinearVelocity, const F
 	MeshComponent->SetPhysicsAngularVelocityInRadians(AngularVelocity);
 }
 
-ECollisionChannel AStarlightActor::GetTeleportableBaseObjectType()
-{
-	return ECC_PhysicsBody;
-}
-
-void AStarlightActor::NotifyHit(UPrimitiveComponent* MyComp, AActor* Other, UPrimitiveComponent* OtherComp,
-                                bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit)
-{
-	Super::NotifyHit(MyComp, Other, OtherComp, bSelfMoved, HitLocation, HitNormal, NormalImpulse, Hit);
-
-	if (!bIsGrabbed || !OtherComp->IsSimulatingPhysics())
-	{
-		return;
-	}
-
-	const float ImpulseStrength = GrabbedMovementSpeed * MeshComponent->BodyInstance.GetBodyMass() * GrabConstants::GrabImpulseMultiplier;
-	OtherComp->AddImpulseAtLocation(ImpulseStrength * -HitNormal, HitLocation);
-}
-
 void AStarlightActor::UpdateMaterialParameters()
 {
 	const int32 PortalCount = OverlappingPortals.Num();
 	if (PortalCount == 0)
 	{
-		DynamicMaterialInstance->SetScalarParameterValue(PortalConstants::CanBeCulledParam, PortalConstants::FloatFalse);
+		UPortalStatics::ClearCullPlane(MeshComponent);
 		return;
 	}
 
@@ -148,7 +131,5 @@ void AStarlightActor::UpdateMaterialParameters()
 		ClosestPortal = DistToFirst < DistToSecond ? OverlappingPortals[0] : OverlappingPortals[1];
 	}
 
-	DynamicMaterialInstance->SetScalarParameterValue(PortalConstants::CanBeCulledParam, PortalConstants::FloatTrue);
-	DynamicMaterialInstance->SetVectorParameterValue(PortalConstants::CullPlaneCenterParam, ClosestPortal->GetActorLocation());
-	DynamicMaterialInstance->SetVectorParameterValue(PortalConstants::CullPlaneNormalParam, ClosestPortal->GetActorForwardVector());
+	UPortalStatics::SetCullPlane(MeshComponent, ClosestPortal->GetActorLocation(), ClosestPortal->GetActorForwardVector());
 }
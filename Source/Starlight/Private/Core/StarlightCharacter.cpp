@@ -14,7 +14,9 @@
 #include "Movement/TeleportComponent.h"
 #include "Portal/Portal.h"
 #include "Portal/PortalConstants.h"
+#include "Portal/PortalCollisionSubsystem.h"
 #include "Portal/PortalComponent.h"
+#include "Portal/PortalTeleportEventSubsystem.h"
 #include "Portal/SkeletalTeleportableCopy.h"
 #include "Statics/StarlightStatics.h"
 
@@ -50,12 +52,12 @@ AStarlightCharacter::AStarlightCharacter(const FObjectInitializer& ObjectInitial
 	HeldObjectCollisionComponent->SetSphereRadius(GetCapsuleComponent()->GetScaledCapsuleRadius());
 	HeldObjectCollisionComponent->SetCollisionResponseToAllChannels(ECR_Ignore);
 	HeldObjectCollisionComponent->SetCollisionResponseToChannel(ECC_PhysicsBody, ECR_Block);
-	HeldObjectCollisionComponent->SetCollisionResponseToChannel(ECC_WithinFirstPortal, ECR_Block);
-	HeldObjectCollisionComponent->SetCollisionResponseToChannel(ECC_WithinSecondPortal, ECR_Block);
-	HeldObjectCollisionComponent->SetCollisionResponseToChannel(ECC_WithinBothPortals, ECR_Block);
 	
 	PortalCopyClass = ASkeletalTeleportableCopy::StaticClass();
 
+	GrabDevicesTick.bCanEverTick = true;
+	GrabDevicesTick.TickGroup = TG_PrePhysics;
+
 	USkeletalMeshComponent* SkeletalMesh = GetMesh();
 	SkeletalMesh->bOwnerNoSee = true;
 	SkeletalMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
@@ -149,6 +151,38 @@ TObjectPtr<UCameraComponent> AStarlightCharacter::GetCameraComponent() const
 	return CameraComponent;
 }
 
+FTransform AStarlightCharacter::GetViewTransform() const
+{
+	// camera only takes HMD pose and control rotation when the view is computed, which happens after everything has ticked
+	if (CameraComponent->bLockToHmd && UStarlightStatics::IsHMDActive())
+	{
+		FQuat Orientation;
+		FVector Position;
+		if (GEngine->XRSystem->GetCurrentPose(IXRTrackingSystem::HMDDeviceId, Orientation, Position))
+		{
+			return FTransform(Orientation, Position) * CameraComponent->GetAttachParent()->GetComponentTransform();
+		}
+	}
+
+	FTransform ViewTransform = CameraComponent->GetComponentTransform();
+	if (CameraComponent->bUsePawnControlRotation)
+	{
+		ViewTransform.SetRotation(GetViewRotation().Quaternion());
+	}
+	return ViewTransform;
+}
+
+const FGrabDevicesTickFunction& AStarlightCharacter::GetGrabDevicesTick() const
+{
+	return GrabDevicesTick;
+}
+
+TObjectPtr<UGrabDevice> AStarlightCharacter::GetGrabDevice(EControllerHand Hand) const
+{
+	const TObjectPtr<UGrabDevice>* GrabDevicePtr = GrabDevices.Find(Hand);
+	return GrabDevicePtr ? *GrabDevicePtr : nullptr;
+}
+
 TObjectPtr<UPrimitiveComponent> AStarlightCharacter::GetCollisionComponent() const
 {
 	return GetCapsuleComponent();
@@ -167,17 +201,14 @@ void AStarlightCharacter::SetTeleportVelocity(const FVector& LinearVelocity, con
 
 FVector AStarlightCharacter::GetTeleportableObjectLocation() const
 {
-	return CameraComponent->GetComponentLocation();
+	// computed from capsule transform since camera transform isn't updated until the end of scoped movement
+	return GetCapsuleComponent()->GetComponentTransform().TransformPosition(CameraComponent->GetRelativeLocation());
 }
 
-void AStarlightCharacter::OnTeleportableMoved()
+bool AStarlightCharacter::IsScaledByPortals() const
 {
-	// we want component transforms to be updated without updating the overlaps
-	UpdateComponentTransforms();
-	for (APortal* Portal : OverlappingPortals)
-	{
-		Portal->OnActorMoved(this);
-	}
+	// resizing capsule and camera setup is not supported, player keeps its size
+	return false;
 }
 
 TSubclassOf<ATeleportableCopy> AStarlightCharacter::GetPortalCopyClass() const
@@ -185,11 +216,6 @@ TSubclassOf<ATeleportableCopy> AStarlightCharacter::GetPortalCopyClass() const
 	return PortalCopyClass;
 }
 
-ECollisionChannel AStarlightCharacter::GetTeleportableBaseObjectType()
-{
-	return ECC_Pawn;
-}
-
 void AStarlightCharacter::LookUp(const float Rate)
 {
 	AddControllerPitchInput(Rate);
@@ -258,6 +284,41 @@ void AStarlightCharacter::Tick(float DeltaSeconds)
 	{
 		IntepolateRotation(DeltaSeconds);
 	}
+}
+
+void AStarlightCharacter::RegisterActorTickFunctions(bool bRegister)
+{
+	Super::RegisterActorTickFunctions(bRegister);
+
+	if (bRegister)
+	{
+		if (GrabDevicesTick.bCanEverTick)
+		{
+			GrabDevicesTick.Target = this;
+			GrabDevicesTick.SetTickFunctionEnable(GrabDevicesTick.bStartWithTickEnabled);
+			GrabDevicesTick.RegisterTickFunction(GetLevel());
+
+			// character movement and controller poses have to be final before devices pick them up
+			GrabDevicesTick.AddPrerequisite(this, PrimaryActorTick);
+			GrabDevicesTick.AddPrerequisite(GetCharacterMovement(), GetCharacterMovement()->PrimaryComponentTick);
+			GrabDevicesTick.AddPrerequisite(LeftController, LeftController->PrimaryComponentTick);
+			GrabDevicesTick.AddPrerequisite(RightController, RightController->PrimaryComponentTick);
+		}
+	}
+	else if (GrabDevicesTick.IsTickFunctionRegistered())
+	{
+		GrabDevicesTick.UnRegisterTickFunction();
+	}
+}
+
+void AStarlightCharacter::TickGrabDevices(float DeltaSeconds)
+{
+	// portal chains of held objects have to know about teleports since the last physics step. Portals teleport bodies
+	// post physics and the character teleports during its movement, both of which are done by the time this runs.
+	if (UPortalTeleportEventSubsystem* TeleportEventSubsystem = GetWorld()->GetSubsystem<UPortalTeleportEventSubsystem>())
+	{
+		TeleportEventSubsystem->DispatchPendingEvents();
+	}
 
 	for (const auto& Entry : GrabDevices)
 	{
@@ -265,28 +326,82 @@ void AStarlightCharacter::Tick(float DeltaSeconds)
 	}
 }
 
-void AStarlightCharacter::OnObjectGrabbed(TObjectPtr<IGrabbable> Grabbable)
+void FGrabDevicesTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread,
+                                           const FGraphEventRef& MyCompletionGraphEvent)
 {
-	UCapsuleComponent* CapsuleComp = GetCapsuleComponent();
-	UPrimitiveComponent* GrabbedComponent = Grabbable->GetComponentToGrab();
-	
-	CapsuleComp->IgnoreComponentWhenMoving(GrabbedComponent, true);
-	GrabbedComponent->IgnoreComponentWhenMoving(CapsuleComp, true);
+	if (Target && IsValidChecked(Target) && !Target->IsUnreachable() && TickType != LEVELTICK_ViewportsOnly)
+	{
+		Target->TickGrabDevices(DeltaTime * Target->CustomTimeDilation);
+	}
+}
+
+FString FGrabDevicesTickFunction::DiagnosticMessage()
+{
+	return Target ? Target->GetFullName() + TEXT("[TickGrabDevices]") : TEXT("<null>[TickGrabDevices]");
+}
+
+void AStarlightCharacter::OnObjectGrabbed(TObjectPtr<IGrabbable> Grabbable, TObjectPtr<UGrabDevice> Device)
+{
+	FHeldObjectState& State = HeldObjects.FindOrAdd(Grabbable->CastToGrabbableActor());
+	if (State.Devices.Num() == 0)
+	{
+		UCapsuleComponent* CapsuleComp = GetCapsuleComponent();
+		UPrimitiveComponent* GrabbedComponent = Grabbable->GetComponentToGrab();
+
+		// held objects keep simulating so collisions with the capsule are ignored in physics too, not only in sweeps
+		if (UPortalCollisionSubsystem* CollisionSubsystem = GetWorld()->GetSubsystem<UPortalCollisionSubsystem>())
+		{
+			State.IgnoreHandle = CollisionSubsystem->AddIgnoreCollision(CapsuleComp, {GrabbedComponent});
+		}
+
+		HeldObjectCollisionComponent->IgnoreComponentWhenMoving(GrabbedComponent, false);
+		GrabbedComponent->IgnoreComponentWhenMoving(HeldObjectCollisionComponent, false);
+		Grabbable->OnGrab();
+	}
 
-	HeldObjectCollisionComponent->IgnoreComponentWhenMoving(GrabbedComponent, false);
-	GrabbedComponent->IgnoreComponentWhenMoving(HeldObjectCollisionComponent, false);
+	State.Devices.AddUnique(Device);
+	State.Devices[0]->OnHoldersChanged();
 }
 
-void AStarlightCharacter::OnObjectReleased(TObjectPtr<IGrabbable> Grabbable)
+void AStarlightCharacter::OnObjectReleased(TObjectPtr<IGrabbable> Grabbable, TObjectPtr<UGrabDevice> Device)
 {
-	UCapsuleComponent* CapsuleComp = GetCapsuleComponent();
+	AActor* GrabbableActor = Grabbable->CastToGrabbableActor();
+	FHeldObjectState* State = HeldObjects.Find(GrabbableActor);
+	if (!State)
+	{
+		return;
+	}
+
+	State->Devices.Remove(Device);
+	if (State->Devices.Num() > 0)
+	{
+		// remaining device takes over, which also hands the object over from one hand to the other
+		State->Devices[0]->OnHoldersChanged();
+		return;
+	}
+
+	if (UPortalCollisionSubsystem* CollisionSubsystem = GetWorld()->GetSubsystem<UPortalCollisionSubsystem>())
+	{
+		CollisionSubsystem->RemoveIgnoreCollision(State->IgnoreHandle);
+	}
+	HeldObjects.Remove(GrabbableActor);
+
 	UPrimitiveComponent* GrabbedComponent = Grabbable->GetComponentToGrab();
-	
-	CapsuleComp->IgnoreComponentWhenMoving(GrabbedComponent, false);
-	GrabbedComponent->IgnoreComponentWhenMoving(CapsuleComp, false);
-	
 	HeldObjectCollisionComponent->IgnoreComponentWhenMoving(GrabbedComponent, true);
 	GrabbedComponent->IgnoreComponentWhenMoving(HeldObjectCollisionComponent, true);
+	Grabbable->OnRelease();
+}
+
+const TArray<TObjectPtr<UGrabDevice>>& AStarlightCharacter::GetObjectHolders(TObjectPtr<IGrabbable> Grabbable) const
+{
+	static const TArray<TObjectPtr<UGrabDevice>> NoHolders;
+	const FHeldObjectState* State = Grabbable ? HeldObjects.Find(Grabbable->CastToGrabbableActor()) : nullptr;
+	return State ? State->Devices : NoHolders;
+}
+
+const TArray<TObjectPtr<APortal>>& AStarlightCharacter::GetOverlappingPortals() const
+{
+	return OverlappingPortals;
 }
 
 void AStarlightCharacter::Teleport(TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal)
@@ -11,8 +11,3 @@ AStarlightGameMode::AStarlightGameMode()
 	DefaultPawnClass = AStarlightCharacter::StaticClass();
 	PlayerControllerClass = AStarlightController::StaticClass();
 }
-
-FActorTeleported& AStarlightGameMode::OnActorTeleported()
-{
-	return ActorTeleportedEvent;
-}
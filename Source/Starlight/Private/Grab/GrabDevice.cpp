@@ -4,7 +4,11 @@
 #include "Grab/GrabDevice.h"
 
 #include "Core/StarlightCharacter.h"
+#include "Grab/GrabConstants.h"
 #include "Grab/Grabbable.h"
+#include "PhysicsEngine/PhysicsHandleComponent.h"
+#include "Portal/Portal.h"
+#include "Portal/PortalTeleportEventSubsystem.h"
 #include "Statics/StarlightMacros.h"
 
 
@@ -17,6 +21,26 @@ void UGrabDevice::Initialize(TObjectPtr<USceneComponent> InOwnerComponent)
 	
 	OwnerComponent = InOwnerComponent;
 	PlayerCharacter = Cast<AStarlightCharacter>(InOwnerComponent->GetOwner());
+
+	PhysicsHandle = NewObject<UPhysicsHandleComponent>(PlayerCharacter);
+	PhysicsHandle->bSoftAngularConstraint = true;
+	PhysicsHandle->bSoftLinearConstraint = true;
+	// target jumps when grabbed object or its holder goes through a portal, interpolating it would drag object along
+	PhysicsHandle->bInterpolateTarget = false;
+	PhysicsHandle->SetLinearStiffness(GrabConstants::HandleLinearStiffness);
+	PhysicsHandle->SetLinearDamping(GrabConstants::HandleLinearDamping);
+	PhysicsHandle->SetAngularStiffness(GrabConstants::HandleAngularStiffness);
+	PhysicsHandle->SetAngularDamping(GrabConstants::HandleAngularDamping);
+	PhysicsHandle->RegisterComponent();
+
+	UpdateHeldChainTransforms();
+
+	TeleportEventSubsystem = GetWorld()->GetSubsystem<UPortalTeleportEventSubsystem>();
+	if (TeleportEventSubsystem)
+	{
+		OwnerTeleportHandle = TeleportEventSubsystem->Subscribe(PlayerCharacter,
+			FPortalTeleportEventDelegate::FDelegate::CreateUObject(this, &UGrabDevice::OnOwnerTeleportEvent));
+	}
 }
 
 TObjectPtr<IGrabbable> UGrabDevice::GetGrabbedObject() const
@@ -29,15 +53,26 @@ bool UGrabDevice::TryGrabbing()
 	return false;
 }
 
-bool UGrabDevice::Grab(TObjectPtr<IGrabbable> ObjectToGrab)
+bool UGrabDevice::Grab(TObjectPtr<IGrabbable> ObjectToGrab, const TArray<TObjectPtr<APortal>>& ThroughPortals)
 {
 	if (GrabbedObject)
 	{
 		return false;
 	}
-	
-	UPrimitiveComponent* GrabbedComponent = ObjectToGrab->GetComponentToGrab();
-	GrabbedComponent->SetSimulatePhysics(false);
+
+	// object held by another device can only be joined by a second device, character arbitrates which one drives it.
+	// Both devices have to reach it through the same portals since their two-handed frame is shared.
+	const TArray<TObjectPtr<UGrabDevice>>& Holders = PlayerCharacter->GetObjectHolders(ObjectToGrab);
+	if (Holders.Num() >= 2 || (Holders.Num() == 1 && (!SupportsSharedGrab() || !Holders[0]->SupportsSharedGrab() ||
+		!Holders[0]->IsHeldThroughSamePortals(ThroughPortals))))
+	{
+		return false;
+	}
+
+	// chain has to be known before the character captures holding transforms
+	HeldThroughPortals.Reset();
+	HeldThroughPortals.Append(ThroughPortals);
+	UpdateHeldChainTransforms();
 	OnSuccessfulGrab(ObjectToGrab);
 	return true;
 }
@@ -45,17 +80,27 @@ bool UGrabDevice::Grab(TObjectPtr<IGrabbable> ObjectToGrab)
 void UGrabDevice::OnSuccessfulGrab(TObjectPtr<IGrabbable> ObjectToGrab)
 {
 	ensure(ObjectToGrab && !GrabbedObject);
-	ObjectToGrab->OnGrab();
 	GrabbedObject = ObjectToGrab->GetGrabbableScriptInterface();
-	PlayerCharacter->OnObjectGrabbed(ObjectToGrab);
+	if (TeleportEventSubsystem)
+	{
+		GrabbedObjectTeleportHandle = TeleportEventSubsystem->Subscribe(ObjectToGrab->CastToGrabbableActor(),
+			FPortalTeleportEventDelegate::FDelegate::CreateUObject(this, &UGrabDevice::OnGrabbedObjectTeleportEvent));
+	}
+	PlayerCharacter->OnObjectGrabbed(ObjectToGrab, this);
 }
 
 void UGrabDevice::OnSuccessfulRelease()
 {
 	ensure(GrabbedObject);
-	PlayerCharacter->OnObjectReleased(GrabbedObject.GetInterface());
-	GrabbedObject->OnRelease();
+	IGrabbable* ReleasedObject = GrabbedObject.GetInterface();
+	if (TeleportEventSubsystem)
+	{
+		TeleportEventSubsystem->Unsubscribe(ReleasedObject->CastToGrabbableActor(), GrabbedObjectTeleportHandle);
+	}
 	GrabbedObject = nullptr;
+	HeldThroughPortals.Empty();
+	UpdateHeldChainTransforms();
+	PlayerCharacter->OnObjectReleased(ReleasedObject, this);
 }
 
 void UGrabDevice::Release()
@@ -63,14 +108,341 @@ void UGrabDevice::Release()
 	if (GrabbedObject)
 	{
 		UPrimitiveComponent* GrabbedComponent = GrabbedObject->GetComponentToGrab();
-		GrabbedComponent->SetSimulatePhysics(true);
+		const bool bIsLastHolder = PlayerCharacter->GetObjectHolders(GrabbedObject.GetInterface()).Num() == 1;
+		FVector LinearVelocity, AngularVelocity;
+		const bool bHasReleaseVelocity = bIsLastHolder && EstimateReleaseVelocity(LinearVelocity, AngularVelocity);
+
+		if (PhysicsHandle->GetGrabbedComponent())
+		{
+			PhysicsHandle->ReleaseComponent();
+		}
 		GrabbedComponent->WakeRigidBody();
+		if (bHasReleaseVelocity)
+		{
+			GrabbedComponent->SetPhysicsLinearVelocity(LinearVelocity);
+			GrabbedComponent->SetPhysicsAngularVelocityInRadians(AngularVelocity);
+		}
+
+		ResetPoseSamples();
 		OnSuccessfulRelease();
 	}
 }
 
 void UGrabDevice::Tick(const float DeltaSeconds)
 {
+	if (!GrabbedObject)
+	{
+		return;
+	}
+
+	// portals might have moved since the last frame
+	UpdateHeldChainTransforms();
+	if (!UpdateHoldState(DeltaSeconds))
+	{
+		Release();
+		return;
+	}
+
+	if (!IsPrimaryHolder())
+	{
+		return;
+	}
+
+	if (FTransform TargetTransform; GetGrabTargetTransform(TargetTransform))
+	{
+		PhysicsHandle->SetTargetLocationAndRotation(TargetTransform.GetLocation(), TargetTransform.Rotator());
+	}
+
+	RecordPoseSample();
+}
+
+bool UGrabDevice::SupportsSharedGrab() const
+{
+	return false;
+}
+
+void UGrabDevice::OnHoldersChanged()
+{
+	if (!GrabbedObject)
+	{
+		return;
+	}
+
+	// object keeps simulating so it's moved at physics rate and pushes other bodies by itself
+	UPrimitiveComponent* GrabbedComponent = GrabbedObject->GetComponentToGrab();
+	if (PhysicsHandle->GetGrabbedComponent() != GrabbedComponent)
+	{
+		ResetPoseSamples();
+		GrabbedComponent->WakeRigidBody();
+		PhysicsHandle->GrabComponentAtLocationWithRotation(GrabbedComponent, NAME_None, GrabbedComponent->GetComponentLocation(),
+		                                                   GrabbedComponent->GetComponentRotation());
+	}
+
+	// holding transforms are captured on device's side of the portals
+	const FTransform ObjectTransform = GrabbedComponent->GetComponentTransform() * HeldChainInverseTransforms[0];
+	const TArray<TObjectPtr<UGrabDevice>>& Holders = PlayerCharacter->GetObjectHolders(GrabbedObject.GetInterface());
+	if (Holders.Num() > 1)
+	{
+		TwoHandedRelativeTransform = ObjectTransform.GetRelativeTransform(GetTwoHandedFrame(Holders[1]));
+	}
+	else if (const USceneComponent* AttachComponent = GetComponentToAttachTo())
+	{
+		GrabbedObjectRelativeTransform = ObjectTransform.GetRelativeTransform(AttachComponent->GetComponentTransform());
+	}
+}
+
+bool UGrabDevice::GetGrabTargetTransform(FTransform& OutTransform) const
+{
+	const USceneComponent* AttachComponent = GetComponentToAttachTo();
+	if (!AttachComponent)
+	{
+		return false;
+	}
+
+	const TArray<TObjectPtr<UGrabDevice>>& Holders = PlayerCharacter->GetObjectHolders(GrabbedObject.GetInterface());
+	if (Holders.Num() > 1)
+	{
+		OutTransform = TwoHandedRelativeTransform * GetTwoHandedFrame(Holders[1]) * HeldChainTransform;
+		return true;
+	}
+
+	OutTransform = GrabbedObjectRelativeTransform * AttachComponent->GetComponentTransform() * HeldChainTransform;
+	return true;
+}
+
+bool UGrabDevice::IsPrimaryHolder() const
+{
+	const TArray<TObjectPtr<UGrabDevice>>& Holders = PlayerCharacter->GetObjectHolders(GrabbedObject.GetInterface());
+	return Holders.Num() > 0 && Holders[0] == this;
+}
+
+void UGrabDevice::UpdateHeldChainTransforms()
+{
+	const int32 PortalCount = HeldThroughPortals.Num();
+	HeldChainTransform = FTransform::Identity;
+	HeldChainInverseTransforms.SetNum(PortalCount + 1, false);
+	HeldChainInverseTransforms[PortalCount] = FTransform::Identity;
+	bIsHeldChainValid = true;
+
+	for (int32 Index = 0; Index < PortalCount; ++Index)
+	{
+		const APortal* Portal = HeldThroughPortals[Index].Get();
+		if (!Portal || !Portal->GetConnectedPortal())
+		{
+			UE_LOG(LogGrab, Error, TEXT("Reference to grabbed object's passed portal is invalid"));
+			bIsHeldChainValid = false;
+			HeldChainTransform = FTransform::Identity;
+			for (FTransform& InverseTransform : HeldChainInverseTransforms)
+			{
+				InverseTransform = FTransform::Identity;
+			}
+			return;
+		}
+
+		HeldChainTransform = HeldChainTransform * Portal->GetPairTransform();
+	}
+
+	// pair transform of the connected portal is the inverse of portal's own pair transform
+	for (int32 Index = PortalCount - 1; Index >= 0; --Index)
+	{
+		const APortal* BackwardsPortal = HeldThroughPortals[Index]->GetConnectedPortal();
+		HeldChainInverseTransforms[Index] = HeldChainInverseTransforms[Index + 1] * BackwardsPortal->GetPairTransform();
+	}
+}
+
+bool UGrabDevice::UpdateHoldState(const float DeltaSeconds)
+{
+	return bIsHeldChainValid;
+}
+
+void UGrabDevice::OnOwnerTeleportEvent(const FPortalTeleportEvent& Event)
+{
+	if (GrabbedObject)
+	{
+		OnOwnerCharacterTeleported(Event.SourcePortal.Get(), Event.TargetPortal.Get());
+	}
+}
+
+void UGrabDevice::OnGrabbedObjectTeleportEvent(const FPortalTeleportEvent& Event)
+{
+	if (GrabbedObject)
+	{
+		OnGrabbedObjectTeleported(Event.SourcePortal.Get(), Event.TargetPortal.Get());
+	}
+}
+
+void UGrabDevice::OnGrabbedObjectTeleported(TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal)
+{
+	const int32 PortalCount = HeldThroughPortals.Num();
+	const APortal* LastPortal = PortalCount > 0 ? HeldThroughPortals[PortalCount - 1].Get() : nullptr;
+	if (LastPortal == TargetPortal)
+	{
+		// Object was teleported back from the last portal, remove it from the list
+		HeldThroughPortals.RemoveAt(PortalCount - 1);
+	}
+	else
+	{
+		// Object was teleported through a new portal, add it to the list
+		HeldThroughPortals.Add(SourcePortal);
+	}
+	UpdateHeldChainTransforms();
+}
+
+void UGrabDevice::OnOwnerCharacterTeleported(TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal)
+{
+	const int32 PortalCount = HeldThroughPortals.Num();
+	const APortal* FirstPortal = PortalCount > 0 ? HeldThroughPortals[0].Get() : nullptr;
+	if (FirstPortal == SourcePortal)
+	{
+		// Character went through the first of portals between it and grabbed object. Since we're no longer holding object through this portal, delete it from the array.
+		HeldThroughPortals.RemoveAt(0);
+	}
+	else
+	{
+		// Character went through a different portal from the first one that we're holding object through so we need to add this new portal to the front of the list.
+		HeldThroughPortals.Insert(TargetPortal, 0);
+	}
+	UpdateHeldChainTransforms();
+
+	// poses recorded so far are on the other side of the portal the character went through
+	ResetPoseSamples();
+}
+
+bool UGrabDevice::IsHeldThroughSamePortals(const TArray<TObjectPtr<APortal>>& ThroughPortals) const
+{
+	if (HeldThroughPortals.Num() != ThroughPortals.Num())
+	{
+		return false;
+	}
+
+	for (int32 Index = 0; Index < ThroughPortals.Num(); ++Index)
+	{
+		if (HeldThroughPortals[Index].Get() != ThroughPortals[Index])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void UGrabDevice::ResetPoseSamples()
+{
+	PoseSampleCount = 0;
+	NextPoseSampleIndex = 0;
+}
+
+void UGrabDevice::RecordPoseSample()
+{
+	// poses are kept on holder's side of portals so that object teleporting doesn't break the fit
+	const FTransform& InverseChainTransform = HeldChainInverseTransforms[0];
+	const FTransform ObjectTransform = GrabbedObject->GetComponentToGrab()->GetComponentTransform();
+
+	FGrabPoseSample& Sample = PoseSamples[NextPoseSampleIndex];
+	Sample.Location = InverseChainTransform.TransformPosition(ObjectTransform.GetLocation());
+	Sample.Rotation = InverseChainTransform.TransformRotation(ObjectTransform.GetRotation());
+	Sample.Time = GetWorld()->GetTimeSeconds();
+
+	NextPoseSampleIndex = (NextPoseSampleIndex + 1) % GrabConstants::ReleaseVelocitySampleCount;
+	PoseSampleCount = FMath::Min(PoseSampleCount + 1, GrabConstants::ReleaseVelocitySampleCount);
+}
+
+bool UGrabDevice::EstimateReleaseVelocity(FVector& OutLinearVelocity, FVector& OutAngularVelocity) const
+{
+	const int32 LatestIndex = (NextPoseSampleIndex + GrabConstants::ReleaseVelocitySampleCount - 1) % GrabConstants::ReleaseVelocitySampleCount;
+	TArray<FGrabPoseSample, TInlineAllocator<GrabConstants::ReleaseVelocitySampleCount>> Samples;
+	for (int32 Offset = 0; Offset < PoseSampleCount; ++Offset)
+	{
+		Samples.Add(PoseSamples[(LatestIndex + GrabConstants::ReleaseVelocitySampleCount - Offset) % GrabConstants::ReleaseVelocitySampleCount]);
+	}
+
+	FVector LinearVelocity;
+	FVector AngularVelocity;
+	if (!FitPoseVelocity(Samples, LinearVelocity, AngularVelocity))
+	{
+		return false;
+	}
+
+	OutLinearVelocity = HeldChainTransform.TransformVector(LinearVelocity);
+	OutAngularVelocity = HeldChainTransform.TransformVectorNoScale(AngularVelocity);
+	return true;
+}
+
+bool UGrabDevice::FitPoseVelocity(TConstArrayView<FGrabPoseSample> Samples, FVector& OutLinearVelocity,
+                                  FVector& OutAngularVelocity)
+{
+	if (Samples.Num() < 2)
+	{
+		return false;
+	}
+
+	const FGrabPoseSample& Latest = Samples[0];
+	const FQuat InverseLatestRotation = Latest.Rotation.Inverse();
+
+	// samples are expressed relative to the latest one, rotations as rotation vectors which are close to linear in time
+	int32 Count = 0;
+	double TimeSum = 0.0;
+	FVector LocationSum = FVector::ZeroVector;
+	FVector RotationSum = FVector::ZeroVector;
+	TStaticArray<FVector, GrabConstants::ReleaseVelocitySampleCount> RotationVectors;
+	for (const FGrabPoseSample& Sample : Samples)
+	{
+		const double Time = Sample.Time - Latest.Time;
+		if (-Time > GrabConstants::ReleaseVelocityWindow || Count == GrabConstants::ReleaseVelocitySampleCount)
+		{
+			break;
+		}
+
+		FQuat Delta = Sample.Rotation * InverseLatestRotation;
+		Delta.EnforceShortestArcWith(FQuat::Identity);
+		RotationVectors[Count] = Delta.ToRotationVector();
+
+		TimeSum += Time;
+		LocationSum += Sample.Location - Latest.Location;
+		RotationSum += RotationVectors[Count];
+		++Count;
+	}
+
+	if (Count < 2)
+	{
+		return false;
+	}
+
+	const double MeanTime = TimeSum / Count;
+	const FVector MeanLocation = LocationSum / Count;
+	const FVector MeanRotation = RotationSum / Count;
+	double TimeVariance = 0.0;
+	FVector LocationCovariance = FVector::ZeroVector;
+	FVector RotationCovariance = FVector::ZeroVector;
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const FGrabPoseSample& Sample = Samples[Index];
+		const double Time = Sample.Time - Latest.Time - MeanTime;
+		TimeVariance += Time * Time;
+		LocationCovariance += (Sample.Location - Latest.Location - MeanLocation) * Time;
+		RotationCovariance += (RotationVectors[Index] - MeanRotation) * Time;
+	}
+
+	if (TimeVariance <= SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	OutLinearVelocity = LocationCovariance / TimeVariance;
+	OutAngularVelocity = RotationCovariance / TimeVariance;
+	return true;
+}
+
+FTransform UGrabDevice::GetTwoHandedFrame(TObjectPtr<const UGrabDevice> OtherDevice) const
+{
+	const USceneComponent* AttachComponent = GetComponentToAttachTo();
+	const USceneComponent* OtherAttachComponent = OtherDevice->GetComponentToAttachTo();
+	const FVector Location = AttachComponent->GetComponentLocation();
+	const FVector OtherLocation = OtherAttachComponent->GetComponentLocation();
+
+	// rolling the object follows the primary hand since the axis between hands doesn't define it
+	const FMatrix Rotation = FRotationMatrix::MakeFromXZ(OtherLocation - Location, AttachComponent->GetUpVector());
+	return FTransform(Rotation.ToQuat(), (Location + OtherLocation) * 0.5f);
 }
 
 TObjectPtr<USceneComponent> UGrabDevice::GetComponentToAttachTo() const
@@ -51,6 +51,3 @@ TObjectPtr<const AActor> IGrabbable::CastToGrabbableActor() const
 	return Cast<AActor>(this);
 }
 
-void IGrabbable::OnGrabbableMoved(const float Speed)
-{
-}
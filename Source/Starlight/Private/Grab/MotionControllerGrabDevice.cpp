@@ -3,58 +3,231 @@
 
 #include "Grab/MotionControllerGrabDevice.h"
 
-#include "Grab/Grabbable.h"
 #include "DrawDebugHelpers.h"
+#include "Components/SphereComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Core/StarlightCharacter.h"
+#include "Core/StarlightConstants.h"
+#include "Engine/Engine.h"
+#include "Grab/Grabbable.h"
+#include "Materials/Material.h"
+#include "Portal/Portal.h"
+#include "Portal/PortalStatics.h"
+#include "Portal/TeleportableCopy.h"
 
 namespace GrabConstants
 {
-	const float TraceRadius = 20.f;
+	const float ProximityRadius = 20.f;
+	const float HighlightScale = 1.05f;
 }
 
 
+static TAutoConsoleVariable CVarDebugDrawGrabProximity(
+                                                       TEXT("Grab.DebugDrawProximity"),
+                                                       false,
+                                                       TEXT("Draws motion controller grab proximity spheres and their best candidates"));
+
+
 void UMotionControllerGrabDevice::Initialize(TObjectPtr<USceneComponent> InOwnerComponent)
 {
 	Super::Initialize(InOwnerComponent);
-	GrabTraceShape.SetSphere(GrabConstants::TraceRadius);
+
+	ProximitySphere = NewObject<USphereComponent>(PlayerCharacter);
+	ProximitySphere->SetSphereRadius(GrabConstants::ProximityRadius);
+	ProximitySphere->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	ProximitySphere->SetCollisionResponseToAllChannels(ECR_Ignore);
+	ProximitySphere->SetCollisionResponseToChannel(ECC_PhysicsBody, ECR_Overlap);
+	ProximitySphere->SetGenerateOverlapEvents(true);
+	ProximitySphere->SetupAttachment(InOwnerComponent);
+	ProximitySphere->OnComponentBeginOverlap.AddDynamic(this, &UMotionControllerGrabDevice::OnProximityBeginOverlap);
+	ProximitySphere->OnComponentEndOverlap.AddDynamic(this, &UMotionControllerGrabDevice::OnProximityEndOverlap);
+	ProximitySphere->RegisterComponent();
+
+	// back faces of the enlarged mesh stick out from behind the candidate and form an outline around it
+	HighlightComponent = NewObject<UStaticMeshComponent>(PlayerCharacter);
+	HighlightComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	HighlightComponent->SetCastShadow(false);
+	HighlightComponent->SetReverseCulling(true);
+	HighlightComponent->SetVisibility(false);
+	HighlightComponent->RegisterComponent();
 }
 
 bool UMotionControllerGrabDevice::TryGrabbing()
 {
-	TArray<FHitResult> HitResults;
-	const FVector TraceCenter = OwnerComponent->GetComponentLocation();
-	GetWorld()->SweepMultiByChannel(HitResults, TraceCenter, TraceCenter, FQuat(), ECC_PhysicsBody, GrabTraceShape);
-	DrawDebugSphere(GetWorld(), TraceCenter, GrabConstants::TraceRadius, 16, FColor::Yellow, false, 3);
+	if (GrabbedObject)
+	{
+		return false;
+	}
+
+	// candidates are kept up to date by tick, grabbing doesn't query anything
+	if (GrabCandidates.Num() == 0)
+	{
+		return false;
+	}
+
+	const FMotionControllerGrabCandidate& Candidate = GrabCandidates[0];
+	IGrabbable* Grabbable = ResolveGrabbable(Candidate.Component.Get());
+	TArray<TObjectPtr<APortal>> ThroughPortals;
+	if (APortal* Portal = Candidate.Portal.Get())
+	{
+		ThroughPortals.Add(Portal);
+	}
+	return Grabbable && Grab(Grabbable, ThroughPortals);
+}
+
+void UMotionControllerGrabDevice::Tick(const float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
 
-	TObjectPtr<IGrabbable> ClosestGrabbable = nullptr;
-	float ClosestDistSquared = FLT_MAX;
-	for (const FHitResult& HitResult : HitResults)
+	if (GrabbedObject)
 	{
-		if (!HitResult.bBlockingHit)
+		return;
+	}
+
+	UpdateGrabCandidates();
+	SetHighlightedCandidate(GrabCandidates.Num() > 0 ? GrabCandidates[0].Component.Get() : nullptr);
+
+#if ENABLE_DRAW_DEBUG
+	if (CVarDebugDrawGrabProximity.GetValueOnGameThread())
+	{
+		const FVector Center = ProximitySphere->GetComponentLocation();
+		DrawDebugSphere(GetWorld(), Center, ProximitySphere->GetScaledSphereRadius(), 16, FColor::Yellow);
+		if (HighlightedCandidate.IsValid())
 		{
-			continue;
+			DrawDebugLine(GetWorld(), Center, HighlightedCandidate->GetComponentLocation(), FColor::Green);
 		}
+	}
+#endif
+}
+
+bool UMotionControllerGrabDevice::SupportsSharedGrab() const
+{
+	return true;
+}
+
+TObjectPtr<USceneComponent> UMotionControllerGrabDevice::GetComponentToAttachTo() const
+{
+	return OwnerComponent;
+}
+
+void UMotionControllerGrabDevice::OnSuccessfulGrab(TObjectPtr<IGrabbable> ObjectToGrab)
+{
+	Super::OnSuccessfulGrab(ObjectToGrab);
+
+	// candidates aren't updated while holding something, they'd be stale by the time the object is released
+	GrabCandidates.Reset();
+	SetHighlightedCandidate(nullptr);
+}
+
+void UMotionControllerGrabDevice::OnProximityBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
+                                                          UPrimitiveComponent* OtherComp, int32 OtherBodyIndex,
+                                                          bool bFromSweep, const FHitResult& SweepResult)
+{
+	if (ResolveGrabbable(OtherComp))
+	{
+		OverlappingComponents.AddUnique(OtherComp);
+	}
+}
+
+void UMotionControllerGrabDevice::OnProximityEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
+                                                        UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+{
+	OverlappingComponents.Remove(OtherComp);
+	if (HighlightedCandidate == OtherComp)
+	{
+		SetHighlightedCandidate(nullptr);
+	}
+}
+
+TObjectPtr<IGrabbable> UMotionControllerGrabDevice::ResolveGrabbable(TObjectPtr<UPrimitiveComponent> Component)
+{
+	return Component ? Cast<IGrabbable>(Component->GetOwner()) : nullptr;
+}
 
-		const TObjectPtr<IGrabbable> Grabbable = Cast<IGrabbable>(HitResult.GetActor());
-		if (Grabbable)
+void UMotionControllerGrabDevice::UpdateGrabCandidates()
+{
+	// objects held by the other hand stay candidates so they can be held with both hands or handed over
+	OverlappingComponents.RemoveAll([](const TWeakObjectPtr<UPrimitiveComponent>& Component)
+	{
+		return !ResolveGrabbable(Component.Get());
+	});
+
+	GrabCandidates.Reset();
+	const FVector Center = ProximitySphere->GetComponentLocation();
+	for (const TWeakObjectPtr<UPrimitiveComponent>& Component : OverlappingComponents)
+	{
+		FMotionControllerGrabCandidate& Candidate = GrabCandidates.AddDefaulted_GetRef();
+		Candidate.Component = Component;
+		Candidate.DistanceSquared = FVector::DistSquared(Center, Component->GetComponentLocation());
+	}
+
+	// copies don't generate overlaps, objects sticking out of a portal are found behind it
+	// controller can only reach into portals the character itself is near
+	for (APortal* Portal : PlayerCharacter->GetOverlappingPortals())
+	{
+		AddCandidatesThroughPortal(Portal);
+	}
+
+	if (GrabCandidates.Num() > 1)
+	{
+		GrabCandidates.Sort([](const FMotionControllerGrabCandidate& First, const FMotionControllerGrabCandidate& Second)
 		{
-			const float DistSquared = Grabbable && FVector::DistSquared(TraceCenter, Grabbable->GetLocation());
-			if (DistSquared < ClosestDistSquared)
-			{
-				ClosestGrabbable = Grabbable;
-				ClosestDistSquared = DistSquared;
-			}
-		}
+			return First.DistanceSquared < Second.DistanceSquared;
+		});
 	}
+}
 
-	if (ClosestGrabbable)
+void UMotionControllerGrabDevice::AddCandidatesThroughPortal(TObjectPtr<APortal> Portal)
+{
+	FCollisionQueryParams QueryParams;
+	QueryParams.AddIgnoredActor(PlayerCharacter);
+	const FVector Center = ProximitySphere->GetComponentLocation();
+	if (!UPortalStatics::OverlapSphereThroughPortal(GetWorld(), PortalOverlaps, Portal, Center,
+	                                                ProximitySphere->GetScaledSphereRadius(),
+	                                                FCollisionObjectQueryParams(ECC_PhysicsBody), QueryParams))
 	{
-		return Grab(ClosestGrabbable);
+		return;
 	}
 
-	return false;
+	const FVector TeleportedCenter = Portal->TeleportLocation(Center);
+	for (const FOverlapResult& Overlap : PortalOverlaps)
+	{
+		// copies on the other side belong to objects on controller's side which are already candidates
+		UPrimitiveComponent* Component = Overlap.GetComponent();
+		if (!Component || Cast<ATeleportableCopy>(Component->GetOwner()) || !ResolveGrabbable(Component))
+		{
+			continue;
+		}
+
+		FMotionControllerGrabCandidate& Candidate = GrabCandidates.AddDefaulted_GetRef();
+		Candidate.Component = Component;
+		Candidate.Portal = Portal;
+		Candidate.DistanceSquared = FVector::DistSquared(TeleportedCenter, Component->GetComponentLocation());
+	}
 }
 
-TObjectPtr<USceneComponent> UMotionControllerGrabDevice::GetComponentToAttachTo() const
+void UMotionControllerGrabDevice::SetHighlightedCandidate(TObjectPtr<UPrimitiveComponent> Candidate)
 {
-	return OwnerComponent;
+	if (HighlightedCandidate == Candidate)
+	{
+		return;
+	}
+
+	HighlightedCandidate = Candidate;
+	UStaticMeshComponent* CandidateMesh = Cast<UStaticMeshComponent>(Candidate);
+	if (!CandidateMesh)
+	{
+		HighlightComponent->SetVisibility(false);
+		HighlightComponent->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+		return;
+	}
+
+	HighlightComponent->SetStaticMesh(CandidateMesh->GetStaticMesh());
+	for (int32 Index = 0; Index < HighlightComponent->GetNumMaterials(); ++Index)
+	{
+		HighlightComponent->SetMaterial(Index, GEngine->WireframeMaterial);
+	}
+	HighlightComponent->AttachToComponent(CandidateMesh, FAttachmentTransformRules::SnapToTargetNotIncludingScale);
+	HighlightComponent->SetRelativeScale3D(FVector(GrabConstants::HighlightScale));
+	HighlightComponent->SetVisibility(true);
 }
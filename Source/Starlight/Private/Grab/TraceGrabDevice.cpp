@@ -6,7 +6,6 @@
 #include "Core/StarlightCharacter.h"
 #include "Camera/CameraComponent.h"
 #include "Core/StarlightActor.h"
-#include "Core/StarlightGameMode.h"
 #include "Grab/Grabbable.h"
 #include "Portal/Portal.h"
 #include "Portal/PortalStatics.h"
@@ -20,12 +19,15 @@ namespace TraceGrabConstants
 	const float MaxHoldDistance = 250.f;
 	const float MinHoldDotProduct = FMath::Cos(FMath::DegreesToRadians(60.f));
 	const float NoSightReleaseDelay = 0.5f;
-	
-	const float MaxMovementSpeed = 1000.f;
-	const float MaxRotationSpeedInRadians = FMath::DegreesToRadians(1080.f);
 }
 
 
+static TAutoConsoleVariable CVarLineOfSightCheckInterval(
+                                                         TEXT("Grab.LineOfSightCheckInterval"),
+                                                         0.1f,
+                                                         TEXT("How often (seconds) trace grab device checks whether it can still see held object. 0 checks every frame"));
+
+
 bool UTraceGrabDevice::TryGrabbing()
 {
 	if (GrabbedObject)
@@ -34,9 +36,9 @@ bool UTraceGrabDevice::TryGrabbing()
 	}
 	
 	FHitResult HitResult;
-	const FVector StartPoint = OwnerComponent->GetComponentLocation();
-	const FVector EndPoint = StartPoint + OwnerComponent->GetComponentRotation().Vector() *
-		TraceGrabConstants::GrabRange;
+	const FTransform ViewTransform = PlayerCharacter->GetViewTransform();
+	const FVector StartPoint = ViewTransform.GetLocation();
+	const FVector EndPoint = StartPoint + ViewTransform.GetRotation().Vector() * TraceGrabConstants::GrabRange;
 
 	FCollisionQueryParams QueryParams;
 	QueryParams.AddIgnoredActor(PlayerCharacter);
@@ -72,40 +74,28 @@ bool UTraceGrabDevice::TryGrabbing()
 	}
 
 	UE_LOG(LogGrab, Verbose, TEXT("Grab trace has hit grabbable actor %s"), *HitResult.GetActor()->GetName());
-	if (!Grab(Grabbable))
+	if (!Grab(Grabbable, CrossedPortals))
 	{
 		return false;
 	}
 
-	HeldThroughPortals.Append(CrossedPortals);
+	bHasLineOfSight = true;
+	bIsSightCheckForced = true;
 	return true;
 }
 
-void UTraceGrabDevice::Initialize(TObjectPtr<USceneComponent> InOwnerComponent)
+bool UTraceGrabDevice::UpdateHoldState(const float DeltaSeconds)
 {
-	Super::Initialize(InOwnerComponent);
-
-	AStarlightGameMode* GameMode = GetWorld()->GetAuthGameMode<AStarlightGameMode>();
-	if (GameMode)
+	// check line of sight to owner component, losing it only starts the release delay so it doesn't have to be checked every frame
+	TimeSinceSightCheck += DeltaSeconds;
+	if (bIsSightCheckForced || TimeSinceSightCheck >= CVarLineOfSightCheckInterval.GetValueOnGameThread())
 	{
-		GameMode->OnActorTeleported().AddUObject(this, &UTraceGrabDevice::OnActorTeleported);
+		bHasLineOfSight = ShouldKeepHoldingObject();
+		bIsSightCheckForced = false;
+		TimeSinceSightCheck = 0.f;
 	}
-}
-
-void UTraceGrabDevice::Tick(const float DeltaSeconds)
-{
-	Super::Tick(DeltaSeconds);
 
-	if (!GrabbedObject)
-	{
-		return;
-	}
-
-	/* TODO: Code in this method is not very well optimized. There are multiple "teleportations" and "unteleportations"
-	 * through portals which could potentially be done just once and then we'd use the results wherever we need them. */
-	
-	// check line of sight to owner component
-	if (!ShouldKeepHoldingObject())
+	if (!bHasLineOfSight)
 	{
 		if (!bIsPendingRelease)
 		{
@@ -119,8 +109,7 @@ void UTraceGrabDevice::Tick(const float DeltaSeconds)
 
 		if (ReleaseDelay <= 0.f)
 		{
-			Release();
-			return;
+			return false;
 		}
 	}
 	else if (bIsPendingRelease)
@@ -128,23 +117,7 @@ void UTraceGrabDevice::Tick(const float DeltaSeconds)
 		bIsPendingRelease = false;
 	}
 
-	// calculate new desired location for grabbed object
-	UPrimitiveComponent* GrabbedComponent = GrabbedObject->GetComponentToGrab();
-	const FVector GrabbedComponentLocation = GrabbedComponent->GetComponentLocation(); 
-	const FVector ToDesiredLocation = GetDesiredGrabbedObjectLocation() - GrabbedComponentLocation;
-	const float MaxMovementSpeed = FMath::Max(TraceGrabConstants::MaxMovementSpeed, PlayerCharacter->GetVelocity().Length());
-	const float MaxMovementDelta = MaxMovementSpeed * DeltaSeconds;
-	const FVector MovementDelta = ToDesiredLocation.GetClampedToMaxSize(MaxMovementDelta);
-
-	// calculate new desired rotation for grabbed object
-	const FQuat CurrentRotation = GrabbedComponent->GetComponentQuat();
-	const FQuat DesiredRotation = GetDesiredGrabbedObjectRotation();
-	const float RotationDistance = CurrentRotation.AngularDistance(DesiredRotation);
-	const float MaxRotationDelta = TraceGrabConstants::MaxRotationSpeedInRadians * DeltaSeconds;
-	const FQuat NewRotation = FQuat::Slerp(CurrentRotation, DesiredRotation, FMath::Min(MaxRotationDelta / RotationDistance, 1.0));
-	
-	GrabbedComponent->MoveComponent(MovementDelta, NewRotation, true);
-	GrabbedObject->OnGrabbableMoved(MovementDelta.Length() / DeltaSeconds);
+	return true;
 }
 
 TObjectPtr<USceneComponent> UTraceGrabDevice::GetComponentToAttachTo() const
@@ -157,106 +130,63 @@ void UTraceGrabDevice::OnSuccessfulRelease()
 	Super::OnSuccessfulRelease();
 
 	bIsPendingRelease = false;
-	HeldThroughPortals.Empty();
+	bHasLineOfSight = true;
 }
 
-FVector UTraceGrabDevice::GetDesiredGrabbedObjectLocation() const
+bool UTraceGrabDevice::GetGrabTargetTransform(FTransform& OutTransform) const
 {
-	ensure(GrabbedObject);
-
-	FVector DesiredLocation = OwnerComponent->GetComponentTransform().
-	                                          TransformPosition(TraceGrabConstants::HeldObjectOffset);
-	for (TWeakObjectPtr<APortal> WeakPassedPortal : HeldThroughPortals)
-	{
-		if (!WeakPassedPortal.IsValid())
-		{
-			UE_LOG(LogGrab, Error, TEXT("Reference to grabbed object's passed portal is invalid"));
-			return DesiredLocation;
-		}
-
-		DesiredLocation = WeakPassedPortal->TeleportLocation(DesiredLocation);
-	}
-
-	return DesiredLocation;
+	OutTransform = FTransform(GetDesiredGrabbedObjectRotation(), GetDesiredGrabbedObjectLocation());
+	return true;
 }
 
-void UTraceGrabDevice::OnActorTeleported(TObjectPtr<ITeleportable> Actor, TObjectPtr<APortal> SourcePortal,
-                                         TObjectPtr<APortal> TargetPortal)
+FVector UTraceGrabDevice::GetDesiredGrabbedObjectLocation() const
 {
-	if (!GrabbedObject)
-	{
-		return;
-	}
-
-	if (GrabbedObject->CastToGrabbableActor() == Actor->CastToTeleportableActor())
-	{
-		OnGrabbedObjectTeleported(SourcePortal, TargetPortal);
-	}
+	ensure(GrabbedObject);
 
-	if (PlayerCharacter == Actor->CastToTeleportableActor())
-	{
-		OnOwnerCharacterTeleported(SourcePortal, TargetPortal);
-	}
+	const FVector DesiredLocation = PlayerCharacter->GetViewTransform().TransformPosition(TraceGrabConstants::HeldObjectOffset);
+	return HeldChainTransform.TransformPosition(DesiredLocation);
 }
 
 void UTraceGrabDevice::OnGrabbedObjectTeleported(TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal)
 {
-	const int32 PortalCount = HeldThroughPortals.Num();
-	const APortal* LastPortal = PortalCount > 0 ? HeldThroughPortals[PortalCount - 1].Get() : nullptr;
-	if (LastPortal == TargetPortal)
-	{
-		// Object was teleported back from the last portal, remove it from the list
-		HeldThroughPortals.RemoveAt(PortalCount - 1);
-	}
-	else
-	{
-		// Object was teleported through a new portal, add it to the list
-		HeldThroughPortals.Add(SourcePortal);
-	}
+	Super::OnGrabbedObjectTeleported(SourcePortal, TargetPortal);
+	bIsSightCheckForced = true;
 }
 
 void UTraceGrabDevice::OnOwnerCharacterTeleported(TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal)
 {
-	const int32 PortalCount = HeldThroughPortals.Num();
-	const APortal* FirstPortal = PortalCount > 0 ? HeldThroughPortals[0].Get() : nullptr;
-	if (FirstPortal == SourcePortal)
-	{
-		// Character went through the first of portals between it and grabbed object. Since we're no longer holding object through this portal, delete it from the array.
-		HeldThroughPortals.RemoveAt(0);
-	}
-	else
-	{
-		// Character went through a different portal from the first one that we're holding object through so we need to add this new portal to the front of the list.
-		HeldThroughPortals.Insert(TargetPortal, 0);
-	}
+	Super::OnOwnerCharacterTeleported(SourcePortal, TargetPortal);
+	bIsSightCheckForced = true;
 }
 
 bool UTraceGrabDevice::ShouldKeepHoldingObject() const
 {
-	const FVector OwnerLocation = OwnerComponent->GetComponentLocation();
+	if (!bIsHeldChainValid)
+	{
+		return false;
+	}
+
+	const FTransform ViewTransform = PlayerCharacter->GetViewTransform();
+	const FVector OwnerLocation = ViewTransform.GetLocation();
+	const FVector OwnerDirection = ViewTransform.GetRotation().Vector();
 	const FVector ObjectLocation = GrabbedObject->GetLocation();
 
-	// get transformed-back point for each portal we're holding an object through
-	FVector TransformedObjectLocation = ObjectLocation;
-	TArray<TTuple<FVector, APortal*>> TransformedPointMap = {{ObjectLocation, nullptr}};
-	for (int32 Index = HeldThroughPortals.Num() - 1; Index >= 0; --Index)
+	// object location as seen in front of each portal we're holding an object through, and then the object itself
+	TArray<TTuple<FVector, APortal*>, TInlineAllocator<4>> TransformedPointMap;
+	for (int32 Index = 0; Index < HeldChainInverseTransforms.Num(); ++Index)
 	{
-		APortal* Portal = HeldThroughPortals[Index].Get();
-		APortal* BackwardsPortal = Portal->GetConnectedPortal();
-		TransformedObjectLocation = BackwardsPortal->TeleportLocation(TransformedObjectLocation);
-		TransformedPointMap.Add({TransformedObjectLocation, Portal});
+		APortal* Portal = HeldThroughPortals.IsValidIndex(Index) ? HeldThroughPortals[Index].Get() : nullptr;
+		TransformedPointMap.Add({HeldChainInverseTransforms[Index].TransformPosition(ObjectLocation), Portal});
 	}
 
-	Algo::Reverse(TransformedPointMap);
 	FVector StartPoint = OwnerLocation;
 
 	// Check whether we're facing the grabbed object. First point is enough to determine that because angle between
 	// direction to object and direction the owner is facing will stay the same after transformation via portals.
 	const FVector ToFirstPointDir = (TransformedPointMap[0].Key - StartPoint).GetSafeNormal();
-	if (ToFirstPointDir.Dot(OwnerComponent->GetComponentRotation().Vector()) < TraceGrabConstants::MinHoldDotProduct)
+	if (ToFirstPointDir.Dot(OwnerDirection) < TraceGrabConstants::MinHoldDotProduct)
 	{
-		UE_LOG(LogGrab, Verbose, TEXT("Not facing grabbed object, dot: %.2f, dropping"),
-		       ToFirstPointDir.Dot(OwnerComponent->GetComponentRotation().Vector()));
+		UE_LOG(LogGrab, Verbose, TEXT("Not facing grabbed object, dot: %.2f, dropping"), ToFirstPointDir.Dot(OwnerDirection));
 		return false;
 	}
 
@@ -301,19 +231,9 @@ bool UTraceGrabDevice::ShouldKeepHoldingObject() const
 	return true;
 }
 
-FQuat UTraceGrabDevice::GetDesiredGrabbedObjectRotation()
+FQuat UTraceGrabDevice::GetDesiredGrabbedObjectRotation() const
 {
-	FVector Location = GrabbedObject->GetLocation();
-	for (int32 Index = HeldThroughPortals.Num() - 1; Index >= 0; --Index)
-	{
-		const APortal* BackwardsPortal = HeldThroughPortals[Index]->GetConnectedPortal();
-		Location = BackwardsPortal->TeleportLocation(Location);
-	}
-
-	FQuat OwnerSpaceRotation = (Location - OwnerComponent->GetComponentLocation()).ToOrientationQuat();
-	for (TWeakObjectPtr<APortal> Portal : HeldThroughPortals)
-	{
-		OwnerSpaceRotation = Portal->TeleportRotation(OwnerSpaceRotation);
-	}
-	return OwnerSpaceRotation;
+	const FVector Location = HeldChainInverseTransforms[0].TransformPosition(GrabbedObject->GetLocation());
+	const FQuat OwnerSpaceRotation = (Location - PlayerCharacter->GetViewTransform().GetLocation()).ToOrientationQuat();
+	return HeldChainTransform.TransformRotation(OwnerSpaceRotation);
 }
@@ -4,6 +4,8 @@
 #include "StarlightCharacterMovementComponent.h"
 
 #include "Core/StarlightCharacter.h"
+#include "Portal/Portal.h"
+#include "Portal/PortalConstants.h"
 
 
 UStarlightCharacterMovementComponent::UStarlightCharacterMovementComponent()
@@ -19,9 +21,81 @@ void UStarlightCharacterMovementComponent::BeginPlay()
 	ensureMsgf(Character, TEXT("UStarlightCharacterMovementComponent can only be used with AStarlightCharacter, current owner: %s"), *GetCharacterOwner()->GetName());
 }
 
-void UStarlightCharacterMovementComponent::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation,
-                                                             const FVector& OldVelocity)
+bool UStarlightCharacterMovementComponent::MoveUpdatedComponentImpl(const FVector& Delta, const FQuat& NewRotation,
+                                                                    bool bSweep, FHitResult* OutHit, ETeleportType Teleport)
 {
-	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
-	Character->OnTeleportableMoved();
+	TObjectPtr<APortal> Portal = nullptr;
+	float CrossingTime = 1.f;
+	if (!bSweep || Teleport != ETeleportType::None || !Character ||
+		!FindCrossedPortal(Delta, Portal, CrossingTime))
+	{
+		return Super::MoveUpdatedComponentImpl(Delta, NewRotation, bSweep, OutHit, Teleport);
+	}
+
+	FHitResult Hit(1.f);
+	const bool bHasMoved = Super::MoveUpdatedComponentImpl(Delta * CrossingTime, NewRotation, bSweep, &Hit, Teleport);
+	if (Hit.bBlockingHit || Hit.bStartPenetrating)
+	{
+		// stopped in front of the portal, hit time has to be relative to the whole move
+		Hit.Time *= CrossingTime;
+		if (OutHit)
+		{
+			*OutHit = Hit;
+		}
+		return bHasMoved;
+	}
+
+	const FVector CrossingLocation = UpdatedComponent->GetComponentLocation();
+	Portal->OnActorMoved(Character.Get());
+	if (UpdatedComponent->GetComponentLocation().Equals(CrossingLocation))
+	{
+		// portal didn't teleport the character, e.g. it got disconnected
+		return Super::MoveUpdatedComponentImpl(Delta * (1.f - CrossingTime), NewRotation, bSweep, OutHit, Teleport);
+	}
+
+	// Move ends at the crossing. Callers slide or step up using the source space delta, so the rest of it can't be
+	// handed back to them. Velocity has been teleported already and the next movement iteration continues from it.
+	if (OutHit)
+	{
+		*OutHit = FHitResult(1.f);
+	}
+	return true;
+}
+
+bool UStarlightCharacterMovementComponent::FindCrossedPortal(const FVector& Delta, TObjectPtr<APortal>& OutPortal,
+                                                             float& OutTime) const
+{
+	const FVector Start = Character->GetTeleportableObjectLocation();
+	const FVector End = Start + Delta;
+	OutTime = 1.f;
+	OutPortal = nullptr;
+
+	for (APortal* Portal : Character->GetOverlappingPortals())
+	{
+		if (!Portal->GetConnectedPortal())
+		{
+			continue;
+		}
+
+		// view point is teleported once it's behind portal plane, same as portal's own check
+		const FVector PortalLocation = Portal->GetActorLocation();
+		const FVector PortalNormal = Portal->GetActorForwardVector();
+		const float StartDistance = FVector::DotProduct(Start - PortalLocation, PortalNormal);
+		const float EndDistance = FVector::DotProduct(End - PortalLocation, PortalNormal);
+		if (StartDistance < 0.f || EndDistance >= 0.f)
+		{
+			continue;
+		}
+
+		const float Time = FMath::Min((StartDistance + PortalConstants::MoveSplitPlaneOffset) / (StartDistance - EndDistance), 1.f);
+		const FVector LocalCrossing = Portal->GetActorTransform().InverseTransformPosition(FMath::Lerp(Start, End, Time));
+		if (Time < OutTime && FMath::Abs(LocalCrossing.Y) <= PortalConstants::HalfSize.Y &&
+			FMath::Abs(LocalCrossing.Z) <= PortalConstants::HalfSize.Z)
+		{
+			OutTime = Time;
+			OutPortal = Portal;
+		}
+	}
+
+	return OutPortal != nullptr;
 }
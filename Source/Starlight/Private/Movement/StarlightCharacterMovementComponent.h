@@ -7,6 +7,7 @@
 #include "StarlightCharacterMovementComponent.generated.h"
 
 class AStarlightCharacter;
+class APortal;
 
 
 UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
@@ -21,12 +22,28 @@ public:
 protected:
 
 	virtual void BeginPlay() override;
-	
-	virtual void OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity) override;
+
+	/**
+	 * Stops swept moves which take character's view through a portal at portal plane. Character is teleported there
+	 * and the move is reported as finished, the next movement iteration continues from the destination portal with
+	 * teleported velocity.
+	 */
+	virtual bool MoveUpdatedComponentImpl(const FVector& Delta, const FQuat& NewRotation, bool bSweep,
+	                                      FHitResult* OutHit = nullptr, ETeleportType Teleport = ETeleportType::None) override;
 
 private:
 
 	UPROPERTY(Transient)
 	TObjectPtr<AStarlightCharacter> Character;
+
+private:
+
+	/**
+	 * Finds the first portal the view point crosses during the move.
+	 * @param Delta move delta
+	 * @param OutPortal crossed portal
+	 * @param OutTime fraction of the move at which the view point is just behind portal plane
+	 */
+	bool FindCrossedPortal(const FVector& Delta, TObjectPtr<APortal>& OutPortal, float& OutTime) const;
 	
 };
@@ -3,7 +3,6 @@
 
 #include "Movement/TeleportComponent.h"
 
-#include "DrawDebugHelpers.h"
 #include "MotionControllerComponent.h"
 #include "NavigationSystem.h"
 #include "Components/CapsuleComponent.h"
@@ -75,6 +74,7 @@ void UTeleportComponent::StartTeleport()
 	if (!bIsTeleporting)
 	{
 		bIsTeleporting = true;
+		InvalidateTeleportCache();
 	}
 }
 
@@ -82,11 +82,10 @@ void UTeleportComponent::FinishTeleport()
 {
 	if (bIsTeleporting)
 	{
-		FPredictProjectilePathResult PredictResult;
-		UpdateTeleport(PredictResult);
-		if (PredictResult.HitResult.IsValidBlockingHit())
+		UpdateTeleportArc(0.f);
+		if (CachedPredictResult.HitResult.IsValidBlockingHit())
 		{
-			OwnerCharacter->TeleportTo(PredictResult.HitResult.Location, OwnerCharacter->GetActorRotation());
+			OwnerCharacter->TeleportTo(CachedPredictResult.HitResult.Location, OwnerCharacter->GetActorRotation());
 		}
 		
 		bIsTeleporting = false;
@@ -94,11 +93,26 @@ void UTeleportComponent::FinishTeleport()
 	}
 }
 
-void UTeleportComponent::UpdateTeleport(FPredictProjectilePathResult& OutPredictResult) const
+void UTeleportComponent::GetLaunchPose(FVector& OutLocation, FVector& OutDirection) const
 {
-	const FVector TeleportDirection = TeleportController ? TeleportController->GetComponentRotation().Vector() : OwnerCharacter->GetControlRotation().Vector(); 
+	OutDirection = TeleportController ? TeleportController->GetComponentRotation().Vector() : OwnerCharacter->GetControlRotation().Vector(); 
+	OutLocation = TeleportController ? TeleportController->GetComponentLocation() : OwnerCharacter->GetActorLocation();
+}
+
+bool UTeleportComponent::UpdateTeleportArc(float DeltaTime)
+{
+	FVector StartLocation, TeleportDirection;
+	GetLaunchPose(StartLocation, TeleportDirection);
+
+	CachedArcAge += DeltaTime;
+	if (bHasCachedArc && CachedArcAge < ArcMaxCacheTime &&
+		FVector::DistSquared(StartLocation, CachedArcLocation) <= FMath::Square(ArcRecomputeDistance) &&
+		TeleportDirection.Dot(CachedArcDirection) >= FMath::Cos(FMath::DegreesToRadians(ArcRecomputeAngle)))
+	{
+		return false;
+	}
+
 	const FVector LaunchVelocity = TeleportDirection * TeleportConstants::ProjectileLaunchSpeed;
-	const FVector StartLocation = TeleportController ? TeleportController->GetComponentLocation() : OwnerCharacter->GetActorLocation();
 	const FPredictProjectilePathParams PredictParams = {
 		ProjectileRadius,
 		StartLocation,
@@ -107,7 +121,45 @@ void UTeleportComponent::UpdateTeleport(FPredictProjectilePathResult& OutPredict
 		ECC_WorldStatic,
 		OwnerCharacter
 	};
-	UGameplayStatics::PredictProjectilePath(this, PredictParams, OutPredictResult);
+	UGameplayStatics::PredictProjectilePath(this, PredictParams, CachedPredictResult);
+
+	CachedArcLocation = StartLocation;
+	CachedArcDirection = TeleportDirection;
+	CachedArcAge = 0.f;
+	bHasCachedArc = true;
+	return true;
+}
+
+void UTeleportComponent::UpdateNavProjection()
+{
+	const FHitResult& HitResult = CachedPredictResult.HitResult;
+	if (!HitResult.IsValidBlockingHit())
+	{
+		bHasProjectionQuery = false;
+		bHasNavLocation = false;
+		return;
+	}
+
+	if (bHasProjectionQuery &&
+		FVector::DistSquared(HitResult.Location, CachedProjectionQuery) <= FMath::Square(NavProjectionRecomputeDistance))
+	{
+		return;
+	}
+
+	CachedProjectionQuery = HitResult.Location;
+	bHasProjectionQuery = true;
+
+	UNavigationSystemV1* NavigationSystem = UNavigationSystemV1::GetCurrent(GetWorld());
+	FNavLocation NavLocation;
+	bHasNavLocation = NavigationSystem && NavigationSystem->ProjectPointToNavigation(HitResult.Location, NavLocation);
+	CachedNavLocation = NavLocation.Location;
+}
+
+void UTeleportComponent::InvalidateTeleportCache()
+{
+	bHasCachedArc = false;
+	bHasProjectionQuery = false;
+	bHasNavLocation = false;
 }
 
 void UTeleportComponent::TickComponent(float DeltaTime, ELevelTick TickType,
@@ -117,33 +169,21 @@ void UTeleportComponent::TickComponent(float DeltaTime, ELevelTick TickType,
 
 	if (bIsTeleporting)
 	{
-		FPredictProjectilePathResult PredictResult;
-		UpdateTeleport(PredictResult);
-
-		bool bIsVisualizerHidden = true;
-		const FHitResult& HitResult = PredictResult.HitResult;
-		if (HitResult.IsValidBlockingHit())
+		if (UpdateTeleportArc(DeltaTime))
 		{
-			UNavigationSystemV1* NavigationSystem = UNavigationSystemV1::GetCurrent(GetWorld());
-			if (FNavLocation NavLocation; NavigationSystem->ProjectPointToNavigation(HitResult.Location, NavLocation))
-			{
-				TeleportVisualizer->SetActorHiddenInGame(false);
-				TeleportVisualizer->UpdateVisualizerLocation(NavLocation.Location);
-				bIsVisualizerHidden = false;
-			}
+			UpdateNavProjection();
+
+			// arc is only drawn in VR, without motion controllers teleport is aimed with the camera
+			TeleportVisualizer->UpdateArc(TeleportController ? CachedPredictResult.PathData : TArray<FPredictProjectilePathPointData>());
 		}
-		TeleportVisualizer->SetActorHiddenInGame(bIsVisualizerHidden);
 
-		if (TeleportController)
+		if (bHasNavLocation)
 		{
-			// debug arc draw, only for VR
-			const TArray<FPredictProjectilePathPointData>& PathData = PredictResult.PathData;
-			for (int32 i = 0; i < PathData.Num() - 1; ++i)
-			{
-				const FVector Offset = OwnerCharacter->GetActorRightVector() * 100.f;
-				DrawDebugLine(GetWorld(), PathData[i].Location, PathData[i + 1].Location, FColor::Purple);
-			}
+			// visualizer faces away from the character so it's updated even if the arc hasn't changed
+			TeleportVisualizer->UpdateVisualizerLocation(CachedNavLocation);
 		}
+		TeleportVisualizer->SetTargetVisibility(bHasNavLocation);
+		TeleportVisualizer->SetActorHiddenInGame(false);
 	}
 }
 
@@ -3,12 +3,26 @@
 
 #include "Movement/TeleportVisualizer.h"
 
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Kismet/GameplayStaticsTypes.h"
+#include "UObject/ConstructorHelpers.h"
+
 
 ATeleportVisualizer::ATeleportVisualizer()
 {
 	StaticMeshComponent = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("StaticMeshComponent"));
 	StaticMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 	RootComponent = StaticMeshComponent;
+
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> ArcSegmentMesh(TEXT("/Engine/BasicShapes/Cube.Cube"));
+	ArcSegmentsComponent = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("ArcSegmentsComponent"));
+	ArcSegmentsComponent->SetStaticMesh(ArcSegmentMesh.Object);
+	ArcSegmentsComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	ArcSegmentsComponent->SetCastShadow(false);
+	ArcSegmentsComponent->SetUsingAbsoluteLocation(true);
+	ArcSegmentsComponent->SetUsingAbsoluteRotation(true);
+	ArcSegmentsComponent->SetUsingAbsoluteScale(true);
+	ArcSegmentsComponent->SetupAttachment(RootComponent);
 }
 
 void ATeleportVisualizer::UpdateVisualizerLocation(const FVector& NewLocation)
@@ -19,3 +33,37 @@ void ATeleportVisualizer::UpdateVisualizerLocation(const FVector& NewLocation)
 	SetActorRotation(NewRotation);
 }
 
+void ATeleportVisualizer::SetTargetVisibility(bool bVisible)
+{
+	StaticMeshComponent->SetVisibility(bVisible);
+}
+
+void ATeleportVisualizer::UpdateArc(const TArray<FPredictProjectilePathPointData>& PathData)
+{
+	const int32 SegmentCount = FMath::Max(PathData.Num() - 1, 0);
+	ArcSegmentTransforms.Reset(SegmentCount);
+	for (int32 Index = 0; Index < SegmentCount; ++Index)
+	{
+		const FVector Start = PathData[Index].Location;
+		const FVector Segment = PathData[Index + 1].Location - Start;
+		const FVector Scale = {Segment.Size() / ArcSegmentMeshLength, ArcThickness, ArcThickness};
+		ArcSegmentTransforms.Emplace(Segment.Rotation(), Start + Segment * 0.5f, Scale);
+	}
+
+	// component is in world space (absolute transform) so instance transforms don't depend on where the target is
+	const int32 InstanceCount = ArcSegmentsComponent->GetInstanceCount();
+	for (int32 Index = InstanceCount - 1; Index >= SegmentCount; --Index)
+	{
+		ArcSegmentsComponent->RemoveInstance(Index);
+	}
+	for (int32 Index = InstanceCount; Index < SegmentCount; ++Index)
+	{
+		ArcSegmentsComponent->AddInstance(FTransform::Identity);
+	}
+
+	if (SegmentCount > 0)
+	{
+		ArcSegmentsComponent->BatchUpdateInstancesTransforms(0, ArcSegmentTransforms, false, true, true);
+	}
+}
+
@@ -10,20 +10,34 @@ UCopyStaticMeshComponent::UCopyStaticMeshComponent()
 
 void UCopyStaticMeshComponent::SetLinkedComponent(TObjectPtr<UPrimitiveComponent> Component)
 {
-	ensureMsgf(!LinkedComponent, TEXT("Linked component is already assigned to static mesh of %s"), *GetOwner()->GetName());
+	ensureMsgf(!Component || !LinkedComponent, TEXT("Linked component is already assigned to static mesh of %s"), *GetOwner()->GetName());
 	LinkedComponent = Component;
 }
 
+void UCopyStaticMeshComponent::SetDrivenOnPhysicsThread(bool bDriven)
+{
+	bIsDrivenOnPhysicsThread = bDriven;
+}
+
+void UCopyStaticMeshComponent::OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	// the body would otherwise get a kinematic target from game thread on top of the one set on physics thread
+	if (bIsDrivenOnPhysicsThread)
+	{
+		UpdateTransformFlags |= EUpdateTransformFlags::SkipPhysicsUpdate;
+	}
+
+	Super::OnUpdateTransform(UpdateTransformFlags, Teleport);
+}
+
 void UCopyStaticMeshComponent::AddForceAtLocation(FVector Force, FVector Location, FName BoneName)
 {
 	Super::AddForceAtLocation(Force, Location, BoneName);
 
 	if (LinkedComponent)
 	{
-		const FVector LocalForce = GetComponentTransform().InverseTransformVectorNoScale(Force);
-		const FVector TransformedForce = LinkedComponent->GetComponentTransform().TransformVectorNoScale(LocalForce);
-		const FVector LocalLocation = GetComponentTransform().InverseTransformPositionNoScale(Location);
-		const FVector TransformedLocation = LinkedComponent->GetComponentTransform().TransformPositionNoScale(LocalLocation);
+		FVector TransformedForce, TransformedLocation;
+		TransformToLinkedComponent(Force, Location, TransformedForce, TransformedLocation);
 		LinkedComponent->AddForceAtLocation(TransformedForce, TransformedLocation, BoneName);
 	}
 }
@@ -35,19 +49,30 @@ void UCopyStaticMeshComponent::AddImpulseAtLocation(FVector Impulse, FVector Loc
 	PropagateImpulseAtLocation(Impulse, Location, BoneName);
 }
 
-void UCopyStaticMeshComponent::OnPhysicsImpulseApplied(const FVector& Impulse, const FVector& Location)
-{
-	PropagateImpulseAtLocation(Impulse, Location);
-}
-
 void UCopyStaticMeshComponent::PropagateImpulseAtLocation(const FVector& Impulse, const FVector& Location, FName BoneName)
 {
 	if (LinkedComponent)
 	{
-		const FVector LocalImpulse = GetComponentTransform().InverseTransformVectorNoScale(Impulse);
-		const FVector TransformedImpulse = LinkedComponent->GetComponentTransform().TransformVectorNoScale(LocalImpulse);
-		const FVector LocalLocation = GetComponentTransform().InverseTransformPositionNoScale(Location);
-		const FVector TransformedLocation = LinkedComponent->GetComponentTransform().TransformPositionNoScale(LocalLocation);
+		FVector TransformedImpulse, TransformedLocation;
+		TransformToLinkedComponent(Impulse, Location, TransformedImpulse, TransformedLocation);
 		LinkedComponent->AddImpulseAtLocation(TransformedImpulse, TransformedLocation, BoneName);
 	}
 }
+
+void UCopyStaticMeshComponent::TransformToLinkedComponent(const FVector& Vector, const FVector& Location,
+                                                          FVector& OutVector, FVector& OutLocation) const
+{
+	const FTransform& Transform = GetComponentTransform();
+	const FTransform& LinkedTransform = LinkedComponent->GetComponentTransform();
+
+	// copy moves SizeRatio times faster than the linked component, so the same change in velocity on the linked
+	// component needs the impulse divided by the ratio and rescaled by the mass difference
+	const float SizeRatio = Transform.GetMaximumAxisScale() / LinkedTransform.GetMaximumAxisScale();
+	const float Mass = GetMass();
+	const float LinkedMass = LinkedComponent->GetMass();
+	const float MassRatio = Mass > KINDA_SMALL_NUMBER && LinkedMass > KINDA_SMALL_NUMBER ? LinkedMass / Mass : 1.f;
+
+	const FVector LocalVector = Transform.InverseTransformVectorNoScale(Vector);
+	OutVector = LinkedTransform.TransformVectorNoScale(LocalVector) * MassRatio / SizeRatio;
+	OutLocation = LinkedTransform.TransformPosition(Transform.InverseTransformPosition(Location));
+}
@@ -3,17 +3,21 @@
 
 #include "Portal/Portal.h"
 
+#include "Async/ParallelFor.h"
 #include "Camera/CameraComponent.h"
 #include "Components/BoxComponent.h"
 #include "Components/SceneCaptureComponent2D.h"
 #include "Core/StarlightConstants.h"
-#include "Core/StarlightGameMode.h"
 #include "Engine/TextureRenderTarget2D.h"
 #include "GameFramework/Character.h"
+#include "Portal/PortalCollisionSubsystem.h"
 #include "Portal/PortalConstants.h"
+#include "Portal/PortalStatics.h"
 #include "Portal/PortalSurface.h"
+#include "Portal/PortalTeleportEventSubsystem.h"
 #include "Portal/Teleportable.h"
 #include "Portal/TeleportableCopy.h"
+#include "Portal/TeleportableCopyPool.h"
 
 
 static TAutoConsoleVariable CVarDebugDrawPortals(
@@ -21,10 +25,20 @@ static TAutoConsoleVariable CVarDebugDrawPortals(
                                                  false,
                                                  TEXT("Enables debug draw for portal-related stuff"));
 
+static TAutoConsoleVariable CVarParallelCopySyncThreshold(
+                                                          TEXT("Portal.ParallelCopySyncThreshold"),
+                                                          16,
+                                                          TEXT("Minimum number of copies per portal for copy transforms to be computed in parallel"));
+
+DECLARE_CYCLE_STAT(TEXT("Portal copy sync"), STAT_PortalCopySync, STATGROUP_Portal);
+DECLARE_CYCLE_STAT(TEXT("Portal copy sync commit"), STAT_PortalCopySyncCommit, STATGROUP_Portal);
+
 
 APortal::APortal()
 {
 	PrimaryActorTick.bCanEverTick = true;
+	// physics bodies are teleported and copies follow their parents once physics results for this frame are known
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
 
 	PortalMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("StaticMeshComponent"));
 	PortalMesh->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
@@ -36,9 +50,6 @@ APortal::APortal()
 
 	BorderMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("BorderMesh"));
 	BorderMesh->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-	BorderMesh->SetCollisionResponseToChannel(ECC_WithinFirstPortal, ECR_Block);
-	BorderMesh->SetCollisionResponseToChannel(ECC_WithinSecondPortal, ECR_Block);
-	BorderMesh->SetCollisionResponseToChannel(ECC_WithinBothPortals, ECR_Block);
 	BorderMesh->SetCollisionResponseToChannel(ECC_Portal, ECR_Ignore);
 	BorderMesh->SetupAttachment(RootComponent);
 
@@ -54,9 +65,6 @@ APortal::APortal()
 	InnerCollisionComponent->SetCollisionResponseToAllChannels(ECR_Ignore);
 	InnerCollisionComponent->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
 	InnerCollisionComponent->SetCollisionResponseToChannel(ECC_PhysicsBody, ECR_Overlap);
-	InnerCollisionComponent->SetCollisionResponseToChannel(ECC_WithinFirstPortal, ECR_Overlap);
-	InnerCollisionComponent->SetCollisionResponseToChannel(ECC_WithinSecondPortal, ECR_Overlap);
-	InnerCollisionComponent->SetCollisionResponseToChannel(ECC_WithinBothPortals, ECR_Overlap);
 	InnerCollisionComponent->SetGenerateOverlapEvents(true);
 	InnerCollisionComponent->SetupAttachment(RootComponent);
 
@@ -67,9 +75,6 @@ APortal::APortal()
 	OuterCollisionComponent->SetCollisionResponseToAllChannels(ECR_Ignore);
 	OuterCollisionComponent->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
 	OuterCollisionComponent->SetCollisionResponseToChannel(ECC_PhysicsBody, ECR_Overlap);
-	OuterCollisionComponent->SetCollisionResponseToChannel(ECC_WithinFirstPortal, ECR_Overlap);
-	OuterCollisionComponent->SetCollisionResponseToChannel(ECC_WithinSecondPortal, ECR_Overlap);
-	OuterCollisionComponent->SetCollisionResponseToChannel(ECC_WithinBothPortals, ECR_Overlap);
 	OuterCollisionComponent->SetGenerateOverlapEvents(true);
 	OuterCollisionComponent->SetupAttachment(RootComponent);
 	
@@ -82,6 +87,8 @@ void APortal::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
+	UpdatePortalTransform(DeltaSeconds);
+
 	if (OtherPortal)
 	{
 		if (ActorsInInnerBox.Num() > 0)
@@ -103,14 +110,7 @@ void APortal::Tick(float DeltaSeconds)
 			}
 		}
 
-		for (const auto& Entry : TeleportableCopies)
-		{
-			ATeleportableCopy* Copy = Entry.Value;
-			// FIXME - this should probably be in a different place, copy movement is all over the place (teleport here, physics in mesh component)
-			FTransform NewTransform = CalculateTransformForCopy(Copy->GetParent());
-			Copy->SetActorTransform(NewTransform);
-			Copy->ResetVelocity();
-		}
+		SyncCopiesWithParents();
 	}
 	
 
@@ -130,12 +130,17 @@ void APortal::Tick(float DeltaSeconds)
 		DrawDebugLine(World, BottomLeft, TopLeft, FColor::Blue, false, - 1, 0, 1.f);
 
 		const FVector Center = GetActorLocation();
-		DrawDebugDirectionalArrow(World, Center, Center + GetActorUpVector() * PortalConstants::HalfSize.Z,
+		DrawDebugDirectionalArrow(World, Center, Center + GetActorUpVector() * PortalConstants::HalfSize.Z * GetActorScale3D().Z,
 		                          20.f, FColor::Red, false, -1, 0, 1.f);
 	}
 #endif
 }
 
+FVector APortal::GetVelocity() const
+{
+	return PortalVelocity;
+}
+
 void APortal::Initialize(const TObjectPtr<APortalSurface> Surface, FVector InLocalCoords, FVector InExtents,
                          EPortalType InPortalType, TObjectPtr<APortal> InOtherPortal)
 {
@@ -157,8 +162,6 @@ void APortal::Initialize(const TObjectPtr<APortalSurface> Surface, FVector InLoc
 	Extents = InExtents;
 	OtherPortal = InOtherPortal;
 
-	InnerCollisionChannel = InPortalType == EPortalType::First ? ECC_WithinFirstPortal : ECC_WithinSecondPortal;
-	
 	// hide attached surface's mesh when capturing scene so it doesn't occlude the view
 	if (UPrimitiveComponent* SurfaceCollisionComp = PortalSurface->GetAttachedSurfaceComponent())
 	{
@@ -186,6 +189,11 @@ FVector APortal::GetExtents() const
 	return Extents;
 }
 
+float APortal::GetSizeRatio() const
+{
+	return OtherPortal ? GetPairTransform().GetScale3D().X : 1.f;
+}
+
 TObjectPtr<APortal> APortal::GetConnectedPortal() const
 {
 	return OtherPortal;
@@ -226,6 +234,7 @@ void APortal::SetConnectedPortal(TObjectPtr<APortal> Portal)
 	if (!Portal)
 	{
 		OtherPortal = nullptr;
+		bPairTransformDirty = true;
 		return;
 	}
 	
@@ -238,14 +247,13 @@ void APortal::SetConnectedPortal(TObjectPtr<APortal> Portal)
 	}
 
 	OtherPortal = Portal;
-	UpdateSceneCaptureClipPlane();
+	OnPairTransformChanged();
 
 	for (const auto& Entry : TeleportableCopies)
 	{
 		ATeleportableCopy* Copy = Entry.Value;
 		FTransform NewTransform = CalculateTransformForCopy(Copy->GetParent());
-		Copy->SetActorTransform(NewTransform);
-		Copy->UpdateCullingParams(Portal->GetActorLocation(), Portal->GetActorForwardVector());
+		Copy->SetActorTransform(NewTransform, false, nullptr, ETeleportType::TeleportPhysics);
 	}
 }
 
@@ -264,8 +272,7 @@ FVector APortal::TeleportLocation(const FVector& Location) const
 		return Location;
 	}
 
-	const FVector RelativeLocation = BackfacingComponent->GetComponentTransform().InverseTransformPosition(Location);
-	return OtherPortal->GetTransform().TransformPosition(RelativeLocation);
+	return GetPairTransform().TransformPosition(Location);
 }
 
 FQuat APortal::TeleportRotation(const FQuat& Quat) const
@@ -275,8 +282,7 @@ FQuat APortal::TeleportRotation(const FQuat& Quat) const
 		return Quat;
 	}
 
-	const FQuat RelativeQuat = BackfacingComponent->GetComponentQuat().Inverse() * Quat;
-	return OtherPortal->GetActorQuat() * RelativeQuat;
+	return GetPairTransform().TransformRotation(Quat);
 }
 
 FRotator APortal::TeleportRotation(const FRotator& Rotator) const
@@ -284,15 +290,33 @@ FRotator APortal::TeleportRotation(const FRotator& Rotator) const
 	return TeleportRotation(FQuat(Rotator)).Rotator();
 }
 
-FVector APortal::TeleportVelocity(const FVector& Velocity) const
+FVector APortal::TeleportVelocity(const FVector& Velocity, const FVector& Location) const
 {
 	if (!OtherPortal)
 	{
 		return Velocity;
 	}
 
-	const FVector RelativeVelocity = BackfacingComponent->GetComponentQuat().UnrotateVector(Velocity);
-	return OtherPortal->GetActorQuat().RotateVector(RelativeVelocity);
+	// velocity is taken relative to the portals so objects carried through by a moving or rotating portal keep their
+	// momentum, rotation contributes tangential velocity at object's location on both sides
+	const FVector RelativeVelocity = Velocity - GetVelocityAtLocation(Location);
+	return GetPairTransform().TransformVector(RelativeVelocity) + OtherPortal->GetVelocityAtLocation(TeleportLocation(Location));
+}
+
+FVector APortal::TeleportAngularVelocity(const FVector& AngularVelocity) const
+{
+	if (!OtherPortal)
+	{
+		return AngularVelocity;
+	}
+
+	const FVector RelativeAngularVelocity = AngularVelocity - PortalAngularVelocity;
+	return GetPairTransform().TransformVectorNoScale(RelativeAngularVelocity) + OtherPortal->PortalAngularVelocity;
+}
+
+FVector APortal::GetVelocityAtLocation(const FVector& Location) const
+{
+	return PortalVelocity + (PortalAngularVelocity ^ (Location - GetActorLocation()));
 }
 
 TObjectPtr<ATeleportableCopy> APortal::RetrieveCopyForActor(TObjectPtr<AActor> Actor) const
@@ -306,10 +330,39 @@ TObjectPtr<ATeleportableCopy> APortal::RetrieveCopyForActor(TObjectPtr<AActor> A
 	return CopyPtr ? *CopyPtr : nullptr;
 }
 
+void APortal::SetCollisionMaskBit(TObjectPtr<UPrimitiveComponent> Component, EPortalCollisionMaskType Type, bool bValue) const
+{
+	if (CollisionSubsystem)
+	{
+		CollisionSubsystem->SetPortalBit(Component, Type, CollisionIndex, bValue);
+	}
+}
+
 void APortal::BeginPlay()
 {
 	Super::BeginPlay();
 
+	if (PortalSurface)
+	{
+		LastSurfaceTransform = PortalSurface->GetActorTransform();
+		SurfaceRelativeTransform = GetActorTransform().GetRelativeTransform(LastSurfaceTransform);
+
+		// surface (and whatever it is attached to) should finish moving before portal follows it
+		AddTickPrerequisiteActor(PortalSurface);
+		if (AActor* SurfaceParent = PortalSurface->GetAttachParentActor())
+		{
+			AddTickPrerequisiteActor(SurfaceParent);
+		}
+	}
+
+	CollisionSubsystem = GetWorld()->GetSubsystem<UPortalCollisionSubsystem>();
+	if (CollisionSubsystem)
+	{
+		CollisionIndex = CollisionSubsystem->RegisterPortal(this);
+	}
+
+	TeleportEventSubsystem = GetWorld()->GetSubsystem<UPortalTeleportEventSubsystem>();
+
 	DynamicInstance = UMaterialInstanceDynamic::Create(PortalMesh->GetMaterial(0), this);
 
 	InnerCollisionComponent->OnComponentBeginOverlap.AddDynamic(this, &APortal::OnInnerBoxStartOverlap);
@@ -319,6 +372,23 @@ void APortal::BeginPlay()
 	OuterCollisionComponent->OnComponentEndOverlap.AddDynamic(this, &APortal::OnOuterBoxEndOverlap);
 }
 
+void APortal::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	for (const auto& Entry : TeleportableCopies)
+	{
+		ReleaseTeleportableCopy(Entry.Value);
+	}
+	TeleportableCopies.Reset();
+
+	if (CollisionSubsystem)
+	{
+		CollisionSubsystem->UnregisterPortal(CollisionIndex);
+		CollisionIndex = INDEX_NONE;
+	}
+}
+
 void APortal::OnInnerBoxStartOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
                                          UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep,
                                          const FHitResult& SweepResult)
@@ -335,19 +405,13 @@ void APortal::OnInnerBoxEndOverlap(UPrimitiveComponent* OverlappedComponent, AAc
 void APortal::OnOuterBoxStartOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
 	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
-	OtherComp->SetCollisionResponseToChannel(InnerCollisionChannel, ECR_Block);
-	OtherComp->SetCollisionResponseToChannel(ECC_WithinBothPortals, ECR_Block);
+	SetCollisionMaskBit(OtherComp, EPortalCollisionMaskType::Outer, true);
 }
 
 void APortal::OnOuterBoxEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
 	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
-	OtherComp->SetCollisionResponseToChannel(InnerCollisionChannel, ECR_Ignore);
-	ECollisionChannel OtherInnerCollisionChannel = InnerCollisionChannel == ECC_WithinFirstPortal ? ECC_WithinSecondPortal : ECC_WithinFirstPortal;
-	if (OtherComp->GetCollisionResponseToChannel(OtherInnerCollisionChannel) == ECR_Ignore)
-	{
-		OtherComp->SetCollisionResponseToChannel(ECC_WithinBothPortals, ECR_Ignore);
-	}
+	SetCollisionMaskBit(OtherComp, EPortalCollisionMaskType::Outer, false);
 }
 
 void APortal::OnActorBeginInnerOverlap(TObjectPtr<AActor> Actor)
@@ -380,10 +444,11 @@ void APortal::OnActorEndInnerOverlap(TObjectPtr<AActor> Actor)
 void APortal::TeleportActor(TObjectPtr<ITeleportable> TeleportingActor)
 {
 	TeleportingActor->Teleport(this, OtherPortal);
-	AStarlightGameMode* GameMode = GetWorld()->GetAuthGameMode<AStarlightGameMode>();
-	if (GameMode)
+
+	// listeners are notified in one batch later instead of running inside portal tick
+	if (TeleportEventSubsystem)
 	{
-		GameMode->OnActorTeleported().Broadcast(TeleportingActor, this, GetConnectedPortal());
+		TeleportEventSubsystem->QueueTeleportEvent(TeleportingActor->CastToTeleportableActor(), this, OtherPortal);
 	}
 	
 	UE_LOG(LogPortal, Verbose, TEXT("Portal %s has teleported actor %s"), *GetName(),
@@ -411,7 +476,7 @@ void APortal::CreateTeleportableCopy(TObjectPtr<ITeleportable> TeleportingActor)
 		TeleportableCopies.Add(ParentActor->GetUniqueID(), Copy);
 		if (Copy->IsHiddenInPortal())
 		{
-			OtherPortal->SceneCaptureComponent->HideActorComponents(Copy);
+			OtherPortal->SceneCaptureComponent->HiddenActors.AddUnique(Copy);
 		}
 		Copy->UpdateCullingParams(OtherPortal->GetActorLocation(), OtherPortal->GetActorForwardVector());
 	}
@@ -419,18 +484,106 @@ void APortal::CreateTeleportableCopy(TObjectPtr<ITeleportable> TeleportingActor)
 
 void APortal::DeleteTeleportableCopy(int32 ParentObjectId)
 {
-	TObjectPtr<ATeleportableCopy>* CopyPtr = TeleportableCopies.Find(ParentObjectId);
-	if (CopyPtr)
+	TObjectPtr<ATeleportableCopy> Copy;
+	if (TeleportableCopies.RemoveAndCopyValue(ParentObjectId, Copy))
+	{
+		ReleaseTeleportableCopy(Copy);
+	}
+}
+
+void APortal::ReleaseTeleportableCopy(TObjectPtr<ATeleportableCopy> Copy)
+{
+	if (!IsValid(Copy))
+	{
+		return;
+	}
+
+	if (OtherPortal)
+	{
+		OtherPortal->SceneCaptureComponent->HiddenActors.Remove(Copy);
+	}
+
+	if (UTeleportableCopyPool* CopyPool = GetWorld()->GetSubsystem<UTeleportableCopyPool>())
+	{
+		CopyPool->ReleaseCopy(Copy);
+	}
+	else
 	{
-		CopyPtr->Get()->Destroy();
-		TeleportableCopies.Remove(ParentObjectId);
+		Copy->Destroy();
 	}
 }
 
 FTransform APortal::CalculateTransformForCopy(TObjectPtr<const AActor> ParentActor) const
 {
-	const FTransform RelativeTransform = ParentActor->GetTransform().GetRelativeTransform(GetActorTransform());
-	return RelativeTransform * OtherPortal->BackfacingComponent->GetComponentTransform();
+	const ITeleportable* Teleportable = Cast<const ITeleportable>(ParentActor);
+	return CalculateTransformForCopy(GetPairTransform(), ParentActor->GetTransform(),
+	                                 !Teleportable || Teleportable->IsScaledByPortals());
+}
+
+FTransform APortal::CalculateTransformForCopy(const FTransform& PairTransform, const FTransform& ParentTransform,
+                                              bool bScaledByPortals)
+{
+	// backfacing rotation is its own inverse so this is the same as relative to portal and then to other backfacing
+	FTransform CopyTransform = ParentTransform * PairTransform;
+	if (!bScaledByPortals)
+	{
+		CopyTransform.SetScale3D(ParentTransform.GetScale3D());
+	}
+	return CopyTransform;
+}
+
+void APortal::CalculateTransformsForCopies(const FTransform& PairTransform, TConstArrayView<FTransform> ParentTransforms,
+                                           TConstArrayView<bool> ParentScaledFlags, TArrayView<FTransform> CopyTransforms,
+                                           bool bForceSingleThread)
+{
+	check(ParentTransforms.Num() == ParentScaledFlags.Num() && ParentTransforms.Num() == CopyTransforms.Num());
+	ParallelFor(ParentTransforms.Num(), [&](int32 Index)
+	{
+		CopyTransforms[Index] = CalculateTransformForCopy(PairTransform, ParentTransforms[Index], ParentScaledFlags[Index]);
+	}, bForceSingleThread ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+void APortal::SyncCopiesWithParents()
+{
+	SCOPE_CYCLE_COUNTER(STAT_PortalCopySync);
+
+	const int32 CopyCount = TeleportableCopies.Num();
+	if (CopyCount == 0)
+	{
+		return;
+	}
+
+	// parent transforms are packed on game thread so the parallel part doesn't touch any UObjects
+	SyncedCopies.Reset(CopyCount);
+	SyncedParentTransforms.Reset(CopyCount);
+	SyncedParentScaledFlags.Reset(CopyCount);
+	for (const auto& Entry : TeleportableCopies)
+	{
+		ATeleportableCopy* Copy = Entry.Value;
+		const AActor* Parent = Copy->GetParent();
+		if (!Parent)
+		{
+			continue;
+		}
+
+		const ITeleportable* Teleportable = Cast<const ITeleportable>(Parent);
+		SyncedCopies.Add(Copy);
+		SyncedParentTransforms.Add(Parent->GetActorTransform());
+		SyncedParentScaledFlags.Add(!Teleportable || Teleportable->IsScaledByPortals());
+	}
+
+	SyncedCopyTransforms.SetNum(SyncedCopies.Num(), false);
+	const bool bSingleThread = SyncedCopies.Num() < CVarParallelCopySyncThreshold.GetValueOnGameThread();
+	CalculateTransformsForCopies(GetPairTransform(), SyncedParentTransforms, SyncedParentScaledFlags, SyncedCopyTransforms,
+	                             bSingleThread);
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_PortalCopySyncCommit);
+		for (int32 Index = 0; Index < SyncedCopies.Num(); ++Index)
+		{
+			SyncedCopies[Index]->FollowParent(SyncedCopyTransforms[Index]);
+		}
+	}
 }
 
 void APortal::UpdateSceneCaptureClipPlane()
@@ -443,3 +596,66 @@ void APortal::UpdateSceneCaptureClipPlane()
 	SceneCaptureComponent->ClipPlaneBase = GetActorLocation();
 	SceneCaptureComponent->ClipPlaneNormal = GetActorForwardVector();
 }
+
+void APortal::UpdatePortalTransform(float DeltaSeconds)
+{
+	if (!PortalSurface)
+	{
+		return;
+	}
+
+	// compared with the previous frame without tolerance so slow movement is followed every frame instead of piling up
+	// into a single jump, static surfaces keep exactly the same transform
+	const FTransform SurfaceTransform = PortalSurface->GetActorTransform();
+	if (SurfaceTransform.Equals(LastSurfaceTransform, 0.f))
+	{
+		PortalVelocity = FVector::ZeroVector;
+		PortalAngularVelocity = FVector::ZeroVector;
+		return;
+	}
+
+	const FTransform OldTransform = GetActorTransform();
+	LastSurfaceTransform = SurfaceTransform;
+	SetActorTransform(SurfaceRelativeTransform * SurfaceTransform);
+	if (DeltaSeconds > 0.f)
+	{
+		FQuat DeltaRotation = GetActorQuat() * OldTransform.GetRotation().Inverse();
+		DeltaRotation.EnforceShortestArcWith(FQuat::Identity);
+		PortalVelocity = (GetActorLocation() - OldTransform.GetLocation()) / DeltaSeconds;
+		PortalAngularVelocity = DeltaRotation.ToRotationVector() / DeltaSeconds;
+	}
+
+	OnPairTransformChanged();
+	if (OtherPortal)
+	{
+		OtherPortal->OnPairTransformChanged();
+	}
+}
+
+void APortal::OnPairTransformChanged()
+{
+	bPairTransformDirty = true;
+	UpdateSceneCaptureClipPlane();
+
+	if (!OtherPortal)
+	{
+		return;
+	}
+
+	for (const auto& Entry : TeleportableCopies)
+	{
+		Entry.Value->UpdateCullingParams(OtherPortal->GetActorLocation(), OtherPortal->GetActorForwardVector());
+		Entry.Value->OnPortalMoved();
+	}
+}
+
+const FTransform& APortal::GetPairTransform() const
+{
+	if (bPairTransformDirty && OtherPortal)
+	{
+		CachedPairTransform = BackfacingComponent->GetComponentTransform().Inverse() * OtherPortal->GetActorTransform();
+		bPairTransformDirty = false;
+	}
+
+	return CachedPairTransform;
+}
@@ -0,0 +1,302 @@
+﻿// Shadowhoof Games, 2022
+
+
+#include "PortalCollisionFilter.h"
+
+#include "Chaos/ContactModification.h"
+#include "Chaos/ParticleHandle.h"
+#include "Chaos/Utilities.h"
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+#include "Portal/PortalConstants.h"
+
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Portal coupled copy contacts"), STAT_PortalCoupledContacts, STATGROUP_Portal);
+
+
+void FPortalCollisionFilterCallback::OnPreSimulate_Internal()
+{
+	if (const FPortalCollisionFilterInput* Input = GetConsumerInput_Internal())
+	{
+		ApplyInput(*Input);
+	}
+
+	SyncCopiesWithParents();
+}
+
+void FPortalCollisionFilterCallback::OnContactModification_Internal(Chaos::FCollisionContactModifier& Modifier)
+{
+	if (BodyMasks.Num() == 0 && IgnoredPairs.Num() == 0 && CopyLinks.Num() == 0)
+	{
+		return;
+	}
+
+	for (Chaos::FContactPairModifier& PairModifier : Modifier)
+	{
+		const Chaos::TVec2<Chaos::FGeometryParticleHandle*> Particles = PairModifier.GetParticlePair();
+		if (IgnoredPairs.Contains(MakePairKey(Particles[0]->UniqueIdx(), Particles[1]->UniqueIdx())))
+		{
+			PairModifier.Disable();
+			continue;
+		}
+
+		FPortalCollisionMask FirstMask, SecondMask;
+		if (GetParticleMask(Particles[0], FirstMask) && GetParticleMask(Particles[1], SecondMask) &&
+			!FPortalCollisionMask::ShouldCollide(FirstMask, SecondMask))
+		{
+			PairModifier.Disable();
+			continue;
+		}
+
+		for (int32 Index = 0; Index < 2; ++Index)
+		{
+			const FCopyLink* Link = CopyLinks.Find(Particles[Index]->UniqueIdx());
+			if (Link && RelayCopyContact(PairModifier, Index, *Link))
+			{
+				// both bodies have already been pushed apart, solving the contact against the kinematic copy as well
+				// would give the other body the same momentum a second time
+				PairModifier.Disable();
+				break;
+			}
+		}
+	}
+
+	ApplyCoupledImpulses();
+}
+
+FTransform FPortalCollisionFilterCallback::PredictTransform(const FTransform& Transform, const FVector& LocalCenterOfMass,
+                                                            const FVector& LinearVelocity, const FVector& AngularVelocity,
+                                                            Chaos::FReal DeltaTime)
+{
+	const FVector CenterOfMass = Transform.TransformPositionNoScale(LocalCenterOfMass);
+	const FQuat NewRotation = Chaos::FRotation3::IntegrateRotationWithAngularVelocity(Transform.GetRotation(), AngularVelocity, DeltaTime);
+	const FVector NewCenterOfMass = CenterOfMass + LinearVelocity * DeltaTime;
+	return FTransform(NewRotation, NewCenterOfMass - NewRotation.RotateVector(LocalCenterOfMass), Transform.GetScale3D());
+}
+
+Chaos::FReal FPortalCollisionFilterCallback::CalculateContactSpeedChange(Chaos::FReal NormalSpeed, Chaos::FReal Separation,
+                                                                        Chaos::FReal DeltaTime)
+{
+	// contacts are generated ahead of touching, those which stay apart until the end of the step are left alone
+	if (Separation >= 0.f || DeltaTime <= 0.f)
+	{
+		return 0.f;
+	}
+
+	// positions are corrected together with velocities so pushing out of penetration also covers the approach
+	return FMath::Max(-NormalSpeed, -Separation / DeltaTime);
+}
+
+void FPortalCollisionFilterCallback::ApplyInput(const FPortalCollisionFilterInput& Input)
+{
+	for (const TPair<Chaos::FUniqueIdx, FPortalCollisionMask>& Update : Input.MaskUpdates)
+	{
+		if (Update.Value.IsEmpty())
+		{
+			BodyMasks.Remove(Update.Key);
+		}
+		else
+		{
+			BodyMasks.Add(Update.Key, Update.Value);
+		}
+	}
+
+	for (const FPortalIgnoreCollisionCommand& Command : Input.IgnoreCommands)
+	{
+		const uint64 PairKey = MakePairKey(Command.First, Command.Second);
+		if (Command.bIgnore)
+		{
+			++IgnoredPairs.FindOrAdd(PairKey);
+		}
+		else if (int32* Count = IgnoredPairs.Find(PairKey); Count && --(*Count) <= 0)
+		{
+			IgnoredPairs.Remove(PairKey);
+		}
+	}
+
+	for (const FPortalCopyLinkCommand& Command : Input.CopyLinkCommands)
+	{
+		if (Command.bRemove)
+		{
+			CopyLinks.Remove(Command.CopyIdx);
+			continue;
+		}
+
+		FCopyLink& Link = CopyLinks.FindOrAdd(Command.CopyIdx);
+		Link.PairTransform = Command.PairTransform;
+		Link.InversePairTransform = Command.PairTransform.Inverse();
+		Link.CopyProxy = Command.CopyProxy;
+		Link.ParentProxy = Command.ParentProxy;
+	}
+
+	// proxies are only resolved once the whole batch is applied, a body destroyed later in the same frame has its link
+	// removed by the batch before its proxy would be touched
+	for (auto It = CopyLinks.CreateIterator(); It; ++It)
+	{
+		FCopyLink& Link = It.Value();
+		if (!Link.CopyProxy)
+		{
+			continue;
+		}
+
+		Chaos::FGeometryParticleHandle* CopyHandle = Link.CopyProxy->GetHandle_LowLevel();
+		Link.Copy = CopyHandle ? CopyHandle->CastToKinematicParticle() : nullptr;
+		Link.Parent = Link.ParentProxy->GetHandle_LowLevel();
+		Link.CopyProxy = nullptr;
+		Link.ParentProxy = nullptr;
+		if (!Link.Copy || !Link.Parent)
+		{
+			// proxy hasn't been registered with the solver yet
+			It.RemoveCurrent();
+		}
+	}
+
+	if (Input.Gravity.IsSet())
+	{
+		Gravity = Input.Gravity.GetValue();
+	}
+}
+
+void FPortalCollisionFilterCallback::SyncCopiesWithParents()
+{
+	const Chaos::FReal DeltaTime = GetDeltaTime_Internal();
+	for (TPair<Chaos::FUniqueIdx, FCopyLink>& Entry : CopyLinks)
+	{
+		FCopyLink& Link = Entry.Value;
+		const FTransform ParentTransform(Link.Parent->R(), Link.Parent->X());
+		if (Link.bIsNew)
+		{
+			// copy may be coming out of the pool, it shouldn't sweep all the way from where it was parked
+			const FTransform CopyTransform = ParentTransform * Link.PairTransform;
+			Link.Copy->SetX(CopyTransform.GetTranslation());
+			Link.Copy->SetR(CopyTransform.GetRotation());
+			Link.Copy->SetV(Chaos::FVec3(0));
+			Link.Copy->SetW(Chaos::FVec3(0));
+			Link.bIsNew = false;
+		}
+
+		// parent is integrated after this, so its current state would leave the copy one step behind
+		FTransform ParentTargetTransform = ParentTransform;
+		if (const Chaos::FPBDRigidParticleHandle* Parent = Link.Parent->CastToRigidParticle();
+			Parent && Parent->ObjectState() == Chaos::EObjectStateType::Dynamic)
+		{
+			const Chaos::FVec3 Velocity = Parent->GravityEnabled() ? Parent->V() + Gravity * DeltaTime : Parent->V();
+			ParentTargetTransform = PredictTransform(ParentTransform, Parent->CenterOfMass(), Velocity, Parent->W(), DeltaTime);
+		}
+
+		const FTransform CopyTransform = ParentTargetTransform * Link.PairTransform;
+		Link.Copy->KinematicTarget().SetTargetMode(CopyTransform.GetTranslation(), CopyTransform.GetRotation());
+	}
+}
+
+bool FPortalCollisionFilterCallback::RelayCopyContact(const Chaos::FContactPairModifier& PairModifier, int32 CopyIndex,
+                                                      const FCopyLink& Link)
+{
+	const Chaos::TVec2<Chaos::FGeometryParticleHandle*> Particles = PairModifier.GetParticlePair();
+	Chaos::FPBDRigidParticleHandle* Other = Particles[1 - CopyIndex]->CastToRigidParticle();
+	if (!Other || Other->ObjectState() != Chaos::EObjectStateType::Dynamic || !Link.Copy || !Link.Parent)
+	{
+		return false;
+	}
+
+	Chaos::FPBDRigidParticleHandle* Parent = Link.Parent->CastToRigidParticle();
+	if (!Parent || Parent->ObjectState() != Chaos::EObjectStateType::Dynamic)
+	{
+		// parent which isn't moved by physics pushes back like the kinematic copy does
+		return false;
+	}
+
+	if (Other == Parent)
+	{
+		// parent can't push itself through the portal
+		return true;
+	}
+
+	const Chaos::FKinematicGeometryParticleHandle* Copy = Link.Copy;
+	const int32 ContactCount = PairModifier.GetNumContacts();
+	const Chaos::FReal DeltaTime = GetDeltaTime_Internal();
+	const Chaos::FVec3 CopyCenter = Copy->X();
+	const Chaos::FVec3 OtherCenter = Other->P();
+	const Chaos::FReal EffectiveMass = 1.f / (Other->InvM() + Parent->InvM());
+	const Chaos::FReal SizeRatio = Link.PairTransform.GetScale3D().X;
+	const Chaos::FVec3 ParentCenter = Parent->P() + Parent->Q().RotateVector(Parent->CenterOfMass());
+
+	for (int32 ContactIndex = 0; ContactIndex < ContactCount; ++ContactIndex)
+	{
+		Chaos::FVec3 FirstLocation, SecondLocation;
+		PairModifier.GetWorldContactLocations(ContactIndex, FirstLocation, SecondLocation);
+		const Chaos::FVec3 Location = (FirstLocation + SecondLocation) * 0.5f;
+
+		// normal pointing from the copy to the other body
+		Chaos::FVec3 Normal = PairModifier.GetWorldNormal(ContactIndex);
+		if (Chaos::FVec3::DotProduct(OtherCenter - CopyCenter, Normal) < 0.f)
+		{
+			Normal = -Normal;
+		}
+
+		const Chaos::FVec3 OtherVelocity = Other->V() + Chaos::FVec3::CrossProduct(Other->W(), Location - OtherCenter);
+		const Chaos::FVec3 CopyVelocity = Copy->V() + Chaos::FVec3::CrossProduct(Copy->W(), Location - CopyCenter);
+		const Chaos::FReal NormalSpeed = Chaos::FVec3::DotProduct(OtherVelocity - CopyVelocity, Normal);
+		const Chaos::FReal SpeedChange = CalculateContactSpeedChange(NormalSpeed, PairModifier.GetSeparation(ContactIndex), DeltaTime);
+		if (SpeedChange <= 0.f)
+		{
+			continue;
+		}
+
+		// every point takes its share so that faces with many contact points don't multiply the impulse, the body
+		// and the parent get equal and opposite impulses so momentum is conserved through the portal
+		const Chaos::FVec3 Impulse = Normal * (SpeedChange * EffectiveMass / ContactCount);
+		FCoupledImpulse& OtherImpulse = CoupledImpulses.FindOrAdd(Other);
+		OtherImpulse.LinearImpulse += Impulse;
+		OtherImpulse.AngularImpulse += Chaos::FVec3::CrossProduct(Location - OtherCenter, Impulse);
+
+		const Chaos::FVec3 ParentImpulse = -Link.InversePairTransform.TransformVectorNoScale(Impulse) / SizeRatio;
+		const Chaos::FVec3 ParentLocation = Link.InversePairTransform.TransformPosition(Location);
+		FCoupledImpulse& CoupledParentImpulse = CoupledImpulses.FindOrAdd(Parent);
+		CoupledParentImpulse.LinearImpulse += ParentImpulse;
+		CoupledParentImpulse.AngularImpulse += Chaos::FVec3::CrossProduct(ParentLocation - ParentCenter, ParentImpulse);
+		INC_DWORD_STAT(STAT_PortalCoupledContacts);
+	}
+
+	return true;
+}
+
+void FPortalCollisionFilterCallback::ApplyCoupledImpulses()
+{
+	const Chaos::FReal DeltaTime = GetDeltaTime_Internal();
+	for (const TPair<Chaos::FPBDRigidParticleHandle*, FCoupledImpulse>& Entry : CoupledImpulses)
+	{
+		Chaos::FPBDRigidParticleHandle* Particle = Entry.Key;
+		const Chaos::FMatrix33 WorldInvInertia = Chaos::Utilities::ComputeWorldSpaceInertia(
+			Particle->Q() * Particle->RotationOfMass(), Particle->InvI());
+		const Chaos::FVec3 DeltaV = Entry.Value.LinearImpulse * Particle->InvM();
+		const Chaos::FVec3 DeltaW = WorldInvInertia * Entry.Value.AngularImpulse;
+
+		// positions are already predicted at this point so they have to be corrected along with velocities
+		Particle->SetV(Particle->V() + DeltaV);
+		Particle->SetW(Particle->W() + DeltaW);
+		Particle->SetP(Particle->P() + DeltaV * DeltaTime);
+		Particle->SetQ(Chaos::FRotation3::IntegrateRotationWithAngularVelocity(Particle->Q(), DeltaW, DeltaTime));
+	}
+
+	CoupledImpulses.Reset();
+}
+
+uint64 FPortalCollisionFilterCallback::MakePairKey(Chaos::FUniqueIdx First, Chaos::FUniqueIdx Second)
+{
+	const uint32 Min = static_cast<uint32>(FMath::Min(First.Idx, Second.Idx));
+	const uint32 Max = static_cast<uint32>(FMath::Max(First.Idx, Second.Idx));
+	return (static_cast<uint64>(Min) << 32) | Max;
+}
+
+bool FPortalCollisionFilterCallback::GetParticleMask(const Chaos::FGeometryParticleHandle* Particle,
+                                                     FPortalCollisionMask& OutMask) const
+{
+	if (const FPortalCollisionMask* Mask = BodyMasks.Find(Particle->UniqueIdx()))
+	{
+		OutMask = *Mask;
+		return true;
+	}
+
+	OutMask = FPortalCollisionMask();
+	return Particle->ObjectState() == Chaos::EObjectStateType::Dynamic;
+}
@@ -0,0 +1,128 @@
+﻿// Shadowhoof Games, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chaos/SimCallbackInput.h"
+#include "Chaos/SimCallbackObject.h"
+#include "Portal/PortalCollisionSubsystem.h"
+
+
+/**
+ * Portal mask changes, ignore collision commands and copy links made on game thread since the last physics step.
+ * Empty mask removes the body.
+ */
+struct FPortalCollisionFilterInput : public Chaos::FSimCallbackInput
+{
+	TArray<TPair<Chaos::FUniqueIdx, FPortalCollisionMask>> MaskUpdates;
+
+	/** Commands in the order they were issued */
+	TArray<FPortalIgnoreCollisionCommand> IgnoreCommands;
+
+	/** Commands in the order they were issued */
+	TArray<FPortalCopyLinkCommand> CopyLinkCommands;
+
+	/** World gravity, only set when it has changed */
+	TOptional<FVector> Gravity;
+
+	void Reset()
+	{
+		MaskUpdates.Reset();
+		IgnoreCommands.Reset();
+		CopyLinkCommands.Reset();
+		Gravity.Reset();
+	}
+};
+
+
+/**
+ * Physics thread side of portal collision filtering. Keeps a copy of body masks and ignored pairs and disables
+ * contacts between bodies which are not supposed to see each other through portals.
+ * Also couples copies with their parents: copies are moved to where their parents are going to be at the end of each
+ * substep, and contacts between a copy and a dynamic body are solved here between that body and copy's parent instead
+ * of against the kinematic copy.
+ */
+class FPortalCollisionFilterCallback : public Chaos::TSimCallbackObject<FPortalCollisionFilterInput, Chaos::FSimCallbackNoOutput, true>
+{
+public:
+
+	virtual void OnPreSimulate_Internal() override;
+
+	virtual void OnContactModification_Internal(Chaos::FCollisionContactModifier& Modifier) override;
+
+	/**
+	 * Returns transform a body is integrated to within a step, ignoring forces other than the ones already included
+	 * in the velocity. Rotation is integrated around the center of mass like the solver does.
+	 */
+	static FTransform PredictTransform(const FTransform& Transform, const FVector& LocalCenterOfMass,
+	                                   const FVector& LinearVelocity, const FVector& AngularVelocity, Chaos::FReal DeltaTime);
+
+	/**
+	 * Returns change in relative normal speed at a contact point which stops the bodies from approaching and from
+	 * ending the step penetrating each other. Zero if they don't touch by the end of the step.
+	 * @param NormalSpeed Relative speed along the contact normal, negative when the bodies are approaching
+	 * @param Separation Distance between the bodies at predicted end of step positions, negative when penetrating
+	 */
+	static Chaos::FReal CalculateContactSpeedChange(Chaos::FReal NormalSpeed, Chaos::FReal Separation, Chaos::FReal DeltaTime);
+
+private:
+
+	struct FCopyLink
+	{
+		FTransform PairTransform;
+		FTransform InversePairTransform;
+
+		/** Copy hasn't been moved by physics thread yet and has to be teleported to its parent */
+		bool bIsNew = true;
+
+		/** Proxies from the link command, only kept until the handles are resolved */
+		FPhysicsActorHandle CopyProxy = nullptr;
+		FPhysicsActorHandle ParentProxy = nullptr;
+
+		/** Valid until the link is removed, game thread unlinks before either body is destroyed */
+		Chaos::FKinematicGeometryParticleHandle* Copy = nullptr;
+		Chaos::FGeometryParticleHandle* Parent = nullptr;
+	};
+
+	struct FCoupledImpulse
+	{
+		Chaos::FVec3 LinearImpulse = Chaos::FVec3(0);
+		Chaos::FVec3 AngularImpulse = Chaos::FVec3(0);
+	};
+
+	TMap<Chaos::FUniqueIdx, FPortalCollisionMask> BodyMasks;
+
+	/** Ignored pairs with a count of how many times each was ignored */
+	TMap<uint64, int32> IgnoredPairs;
+
+	TMap<Chaos::FUniqueIdx, FCopyLink> CopyLinks;
+
+	/** Impulses gathered from copy contacts during the current contact modification, per body */
+	TMap<Chaos::FPBDRigidParticleHandle*, FCoupledImpulse> CoupledImpulses;
+
+	Chaos::FVec3 Gravity = Chaos::FVec3(0.f, 0.f, -980.f);
+
+private:
+
+	/** Applies game thread commands in order, then resolves handles of the links which were added or changed. */
+	void ApplyInput(const FPortalCollisionFilterInput& Input);
+
+	/** Moves copies to mirror the state their parents are going to have at the end of the step. */
+	void SyncCopiesWithParents();
+
+	/**
+	 * Solves every contact point between a copy and a dynamic body as a contact between that body and copy's parent.
+	 * Returns true if the contact was handled and shouldn't be solved against the kinematic copy.
+	 */
+	bool RelayCopyContact(const Chaos::FContactPairModifier& PairModifier, int32 CopyIndex, const FCopyLink& Link);
+
+	void ApplyCoupledImpulses();
+
+	static uint64 MakePairKey(Chaos::FUniqueIdx First, Chaos::FUniqueIdx Second);
+
+	/**
+	 * Returns false if collisions of this particle shouldn't be filtered at all. Unmasked static and kinematic bodies
+	 * are world geometry, unmasked dynamic bodies are treated as being far away from any portal.
+	 */
+	bool GetParticleMask(const Chaos::FGeometryParticleHandle* Particle, FPortalCollisionMask& OutMask) const;
+};
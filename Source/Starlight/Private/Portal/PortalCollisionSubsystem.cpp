@@ -0,0 +1,448 @@
+﻿// Shadowhoof Games, 2022
+
+
+#include "Portal/PortalCollisionSubsystem.h"
+
+#include "PBDRigidsSolver.h"
+#include "PortalCollisionFilter.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "Portal/PortalConstants.h"
+#include "Portal/PortalSurface.h"
+#include "Statics/StarlightStatics.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Portal collision subsystem tick"), STAT_PortalCollisionTick, STATGROUP_Portal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Portal filter change requests"), STAT_PortalFilterChangeRequests, STATGROUP_Portal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Portal filter updates"), STAT_PortalFilterUpdates, STATGROUP_Portal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Portal ignore collision commands"), STAT_PortalIgnoreCommands, STATGROUP_Portal);
+
+
+bool FPortalIgnoreCollisionHandle::IsValid() const
+{
+	return Id != INDEX_NONE;
+}
+
+bool FPortalCollisionMask::IsEmpty() const
+{
+	return InnerMask == 0 && OuterMask == 0 && CopyMask == 0;
+}
+
+uint64& FPortalCollisionMask::GetMask(EPortalCollisionMaskType Type)
+{
+	switch (Type)
+	{
+	case EPortalCollisionMaskType::Inner:
+		return InnerMask;
+	case EPortalCollisionMaskType::Outer:
+		return OuterMask;
+	default:
+		return CopyMask;
+	}
+}
+
+bool FPortalCollisionMask::ShouldCollide(const FPortalCollisionMask& First, const FPortalCollisionMask& Second)
+{
+	if (First.CopyMask != 0 || Second.CopyMask != 0)
+	{
+		if (First.CopyMask != 0 && Second.CopyMask != 0)
+		{
+			return false;
+		}
+
+		const FPortalCollisionMask& Copy = First.CopyMask != 0 ? First : Second;
+		const FPortalCollisionMask& Other = First.CopyMask != 0 ? Second : First;
+		return (Copy.CopyMask & Other.InnerMask) != 0;
+	}
+
+	const bool bFirstAllowed = First.InnerMask == 0 || (First.InnerMask & Second.OuterMask) != 0;
+	const bool bSecondAllowed = Second.InnerMask == 0 || (Second.InnerMask & First.OuterMask) != 0;
+	return bFirstAllowed && bSecondAllowed;
+}
+
+void UPortalCollisionSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	FPhysScene* PhysicsScene = InWorld.GetPhysicsScene();
+	Chaos::FPhysicsSolver* Solver = PhysicsScene ? PhysicsScene->GetSolver() : nullptr;
+	if (!Solver)
+	{
+		UE_LOG(LogPortal, Error, TEXT("No physics solver found, portal collision filtering is disabled"));
+		return;
+	}
+
+	FilterCallback = Solver->CreateAndRegisterSimCallbackObject_External<FPortalCollisionFilterCallback>(true);
+}
+
+void UPortalCollisionSubsystem::Deinitialize()
+{
+	if (FilterCallback)
+	{
+		if (FPhysScene* PhysicsScene = GetWorld()->GetPhysicsScene())
+		{
+			PhysicsScene->GetSolver()->UnregisterAndFreeSimCallbackObject_External(FilterCallback);
+		}
+		FilterCallback = nullptr;
+	}
+
+	BodyMasks.Empty();
+	PendingMaskUpdates.Empty();
+	IgnoreEntries.Empty();
+	PendingIgnoreCommands.Empty();
+	PendingCopyLinkCommands.Empty();
+	CopyLinks.Empty();
+	SentGravityZ.Reset();
+	UsedPortalBits = 0;
+
+	Super::Deinitialize();
+}
+
+void UPortalCollisionSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PortalCollisionTick);
+	Super::Tick(DeltaTime);
+
+	FlushPhysicsCommands();
+}
+
+TStatId UPortalCollisionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPortalCollisionSubsystem, STATGROUP_Portal);
+}
+
+int32 UPortalCollisionSubsystem::RegisterPortal(TObjectPtr<APortal> Portal)
+{
+	for (int32 Index = 0; Index < MaxPortals; ++Index)
+	{
+		const uint64 Bit = 1ull << Index;
+		if ((UsedPortalBits & Bit) == 0)
+		{
+			UsedPortalBits |= Bit;
+			return Index;
+		}
+	}
+
+	UE_LOG(LogPortal, Error, TEXT("Can't register portal %s, all %d portal collision bits are taken"),
+	       *GetNameSafe(Portal), MaxPortals);
+	return INDEX_NONE;
+}
+
+void UPortalCollisionSubsystem::UnregisterPortal(int32 PortalIndex)
+{
+	if (PortalIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	const uint64 Bit = 1ull << PortalIndex;
+	UsedPortalBits &= ~Bit;
+
+	for (auto It = BodyMasks.CreateIterator(); It; ++It)
+	{
+		FPortalCollisionMask& Mask = It.Value();
+		if (((Mask.InnerMask | Mask.OuterMask | Mask.CopyMask) & Bit) == 0)
+		{
+			continue;
+		}
+
+		Mask.InnerMask &= ~Bit;
+		Mask.OuterMask &= ~Bit;
+		Mask.CopyMask &= ~Bit;
+		PushMask(It.Key().Get(), Mask);
+		if (Mask.IsEmpty())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UPortalCollisionSubsystem::SetPortalBit(TObjectPtr<UPrimitiveComponent> Component, EPortalCollisionMaskType Type,
+                                             int32 PortalIndex, bool bValue)
+{
+	if (!Component || PortalIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	const uint64 Bit = 1ull << PortalIndex;
+	FPortalCollisionMask& Mask = BodyMasks.FindOrAdd(Component);
+	uint64& TypeMask = Mask.GetMask(Type);
+	if (((TypeMask & Bit) != 0) == bValue)
+	{
+		return;
+	}
+
+	TypeMask = bValue ? TypeMask | Bit : TypeMask & ~Bit;
+	PushMask(Component, Mask);
+	if (Mask.IsEmpty())
+	{
+		BodyMasks.Remove(Component);
+	}
+}
+
+void UPortalCollisionSubsystem::ClearMask(TObjectPtr<UPrimitiveComponent> Component)
+{
+	if (BodyMasks.Remove(Component) > 0)
+	{
+		PushMask(Component, FPortalCollisionMask());
+	}
+}
+
+FPortalIgnoreCollisionHandle UPortalCollisionSubsystem::AddIgnoreCollision(TObjectPtr<UPrimitiveComponent> Component,
+	const TArray<TObjectPtr<UPrimitiveComponent>>& OtherComponents)
+{
+	FPortalIgnoreCollisionHandle Handle;
+	if (!Component)
+	{
+		return Handle;
+	}
+
+	FIgnoreCollisionEntry Entry;
+	Entry.Component = Component;
+	for (UPrimitiveComponent* OtherComponent : OtherComponents)
+	{
+		if (!OtherComponent)
+		{
+			continue;
+		}
+
+		Component->IgnoreComponentWhenMoving(OtherComponent, true);
+		OtherComponent->IgnoreComponentWhenMoving(Component, true);
+		Entry.OtherComponents.Add(OtherComponent);
+
+		if (Component->BodyInstance.ActorHandle && OtherComponent->BodyInstance.ActorHandle)
+		{
+			const FPortalIgnoreCollisionCommand Command = {
+				UStarlightStatics::GetPhysicsHandleID(Component),
+				UStarlightStatics::GetPhysicsHandleID(OtherComponent),
+				true
+			};
+			Entry.PhysicsPairs.Add(Command);
+			PendingIgnoreCommands.Add(Command);
+		}
+	}
+
+	Handle.Id = NextIgnoreHandleId++;
+	IgnoreEntries.Add(Handle.Id, MoveTemp(Entry));
+	return Handle;
+}
+
+void UPortalCollisionSubsystem::RemoveIgnoreCollision(FPortalIgnoreCollisionHandle& Handle)
+{
+	FIgnoreCollisionEntry Entry;
+	if (!Handle.IsValid() || !IgnoreEntries.RemoveAndCopyValue(Handle.Id, Entry))
+	{
+		Handle = FPortalIgnoreCollisionHandle();
+		return;
+	}
+
+	UPrimitiveComponent* Component = Entry.Component.Get();
+	for (const TWeakObjectPtr<UPrimitiveComponent>& WeakOtherComponent : Entry.OtherComponents)
+	{
+		UPrimitiveComponent* OtherComponent = WeakOtherComponent.Get();
+		if (Component && OtherComponent)
+		{
+			Component->IgnoreComponentWhenMoving(OtherComponent, false);
+			OtherComponent->IgnoreComponentWhenMoving(Component, false);
+		}
+	}
+
+	for (FPortalIgnoreCollisionCommand& Command : Entry.PhysicsPairs)
+	{
+		Command.bIgnore = false;
+		PendingIgnoreCommands.Add(Command);
+	}
+
+	Handle = FPortalIgnoreCollisionHandle();
+}
+
+void UPortalCollisionSubsystem::IgnorePortalSurface(TObjectPtr<UPrimitiveComponent> Component,
+                                                    TObjectPtr<APortalSurface> PortalSurface)
+{
+	if (!Component || !PortalSurface)
+	{
+		return;
+	}
+
+	TMap<TWeakObjectPtr<APortalSurface>, FPortalIgnoreCollisionHandle>& SurfaceHandles = SurfaceIgnoreHandles.FindOrAdd(Component);
+	if (SurfaceHandles.Contains(PortalSurface))
+	{
+		return;
+	}
+
+	TArray<TObjectPtr<UPrimitiveComponent>> SurfaceCollisionComponents;
+	PortalSurface->GetCollisionComponents(SurfaceCollisionComponents);
+	SurfaceHandles.Add(PortalSurface, AddIgnoreCollision(Component, SurfaceCollisionComponents));
+}
+
+void UPortalCollisionSubsystem::RestorePortalSurface(TObjectPtr<UPrimitiveComponent> Component,
+                                                     TObjectPtr<APortalSurface> PortalSurface)
+{
+	TMap<TWeakObjectPtr<APortalSurface>, FPortalIgnoreCollisionHandle>* SurfaceHandles = SurfaceIgnoreHandles.Find(Component);
+	FPortalIgnoreCollisionHandle Handle;
+	if (!SurfaceHandles || !SurfaceHandles->RemoveAndCopyValue(PortalSurface, Handle))
+	{
+		return;
+	}
+
+	if (SurfaceHandles->Num() == 0)
+	{
+		SurfaceIgnoreHandles.Remove(Component);
+	}
+	RemoveIgnoreCollision(Handle);
+}
+
+bool UPortalCollisionSubsystem::SetCopyLink(TObjectPtr<UPrimitiveComponent> CopyComponent,
+                                            TObjectPtr<UPrimitiveComponent> ParentComponent, const FTransform& PairTransform)
+{
+	if (!FilterCallback || !CopyComponent || !ParentComponent || !CopyComponent->BodyInstance.ActorHandle ||
+		!ParentComponent->BodyInstance.ActorHandle)
+	{
+		return false;
+	}
+
+	const int32 ExistingIndex = CopyLinks.IndexOfByPredicate([CopyComponent](const FCopyLinkEntry& Entry)
+	{
+		return Entry.Copy == CopyComponent;
+	});
+	FCopyLinkEntry& Entry = ExistingIndex != INDEX_NONE ? CopyLinks[ExistingIndex] : CopyLinks.AddDefaulted_GetRef();
+	Entry.Copy = CopyComponent;
+	Entry.Parent = ParentComponent;
+	Entry.PairTransform = PairTransform;
+	Entry.CopyIdx = UStarlightStatics::GetPhysicsHandleID(CopyComponent);
+	PushCopyLink(Entry);
+
+	// physics thread resolves the proxies once when it applies the link, so it has to be unlinked in the same frame
+	// the body of either component goes away
+	CopyComponent->OnComponentPhysicsStateChanged.AddUniqueDynamic(this, &UPortalCollisionSubsystem::OnLinkedBodyPhysicsStateChanged);
+	ParentComponent->OnComponentPhysicsStateChanged.AddUniqueDynamic(this, &UPortalCollisionSubsystem::OnLinkedBodyPhysicsStateChanged);
+	return true;
+}
+
+void UPortalCollisionSubsystem::RemoveCopyLink(TObjectPtr<UPrimitiveComponent> CopyComponent)
+{
+	const int32 Index = CopyLinks.IndexOfByPredicate([CopyComponent](const FCopyLinkEntry& Entry)
+	{
+		return Entry.Copy == CopyComponent;
+	});
+	if (Index != INDEX_NONE)
+	{
+		RemoveCopyLinkAt(Index);
+	}
+}
+
+bool UPortalCollisionSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPortalCollisionSubsystem::PushMask(TObjectPtr<UPrimitiveComponent> Component, const FPortalCollisionMask& Mask)
+{
+	if (!FilterCallback || !Component || !Component->BodyInstance.ActorHandle)
+	{
+		return;
+	}
+
+	// unique index is resolved right away because component might be destroyed before the flush
+	INC_DWORD_STAT(STAT_PortalFilterChangeRequests);
+	PendingMaskUpdates.Add(UStarlightStatics::GetPhysicsHandleID(Component), Mask);
+}
+
+void UPortalCollisionSubsystem::FlushPhysicsCommands()
+{
+	const float GravityZ = GetWorld()->GetGravityZ();
+	const bool bGravityChanged = !SentGravityZ.IsSet() || SentGravityZ.GetValue() != GravityZ;
+	if (!FilterCallback || (PendingMaskUpdates.Num() == 0 && PendingIgnoreCommands.Num() == 0 &&
+		PendingCopyLinkCommands.Num() == 0 && !bGravityChanged))
+	{
+		return;
+	}
+
+	INC_DWORD_STAT_BY(STAT_PortalFilterUpdates, PendingMaskUpdates.Num());
+	INC_DWORD_STAT_BY(STAT_PortalIgnoreCommands, PendingIgnoreCommands.Num());
+	FPortalCollisionFilterInput* Input = FilterCallback->GetProducerInputData_External();
+	Input->MaskUpdates.Reserve(Input->MaskUpdates.Num() + PendingMaskUpdates.Num());
+	for (const TPair<Chaos::FUniqueIdx, FPortalCollisionMask>& Update : PendingMaskUpdates)
+	{
+		Input->MaskUpdates.Add(Update);
+	}
+	Input->IgnoreCommands.Append(PendingIgnoreCommands);
+	Input->CopyLinkCommands.Append(PendingCopyLinkCommands);
+	if (bGravityChanged)
+	{
+		Input->Gravity = FVector(0.f, 0.f, GravityZ);
+		SentGravityZ = GravityZ;
+	}
+
+	PendingMaskUpdates.Reset();
+	PendingIgnoreCommands.Reset();
+	PendingCopyLinkCommands.Reset();
+}
+
+void UPortalCollisionSubsystem::PushCopyLink(const FCopyLinkEntry& Entry)
+{
+	FPortalCopyLinkCommand& Command = PendingCopyLinkCommands.AddDefaulted_GetRef();
+	Command.CopyIdx = Entry.CopyIdx;
+	Command.CopyProxy = Entry.Copy->BodyInstance.ActorHandle;
+	Command.ParentProxy = Entry.Parent->BodyInstance.ActorHandle;
+	Command.PairTransform = Entry.PairTransform;
+}
+
+void UPortalCollisionSubsystem::PushCopyUnlink(const FCopyLinkEntry& Entry)
+{
+	// queued link would be applied after the removal
+	PendingCopyLinkCommands.RemoveAll([&Entry](const FPortalCopyLinkCommand& Pending)
+	{
+		return Pending.CopyIdx == Entry.CopyIdx;
+	});
+	if (FilterCallback)
+	{
+		FPortalCopyLinkCommand& Command = FilterCallback->GetProducerInputData_External()->CopyLinkCommands.AddDefaulted_GetRef();
+		Command.CopyIdx = Entry.CopyIdx;
+		Command.bRemove = true;
+	}
+}
+
+void UPortalCollisionSubsystem::RemoveCopyLinkAt(int32 Index)
+{
+	const FCopyLinkEntry Entry = CopyLinks[Index];
+	CopyLinks.RemoveAtSwap(Index);
+	PushCopyUnlink(Entry);
+
+	// a parent can have a copy in each portal, it's watched until the last of them is unlinked
+	for (UPrimitiveComponent* Component : {Entry.Copy.Get(), Entry.Parent.Get()})
+	{
+		const bool bIsStillLinked = CopyLinks.ContainsByPredicate([Component](const FCopyLinkEntry& Other)
+		{
+			return Other.Copy == Component || Other.Parent == Component;
+		});
+		if (Component && !bIsStillLinked)
+		{
+			Component->OnComponentPhysicsStateChanged.RemoveDynamic(this, &UPortalCollisionSubsystem::OnLinkedBodyPhysicsStateChanged);
+		}
+	}
+}
+
+void UPortalCollisionSubsystem::OnLinkedBodyPhysicsStateChanged(UPrimitiveComponent* ChangedComponent,
+                                                                EComponentPhysicsStateChange StateChange)
+{
+	for (FCopyLinkEntry& Entry : CopyLinks)
+	{
+		if (Entry.Copy != ChangedComponent && Entry.Parent != ChangedComponent)
+		{
+			continue;
+		}
+
+		if (StateChange == EComponentPhysicsStateChange::Destroyed)
+		{
+			PushCopyUnlink(Entry);
+		}
+		else if (Entry.Copy.IsValid() && Entry.Parent.IsValid() && Entry.Copy->BodyInstance.ActorHandle &&
+			Entry.Parent->BodyInstance.ActorHandle)
+		{
+			// body was recreated, e.g. after a collision change, and has a new particle
+			Entry.CopyIdx = UStarlightStatics::GetPhysicsHandleID(Entry.Copy.Get());
+			PushCopyLink(Entry);
+		}
+	}
+}
@@ -18,6 +18,8 @@ DEFINE_LOG_CATEGORY(LogPortal);
 UPortalComponent::UPortalComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
+	// capture views are updated after character has moved and portals have teleported everything for this frame
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
 
 	PortalClasses = {
 		{EPortalType::First, APortal::StaticClass()},
@@ -60,6 +62,8 @@ void UPortalComponent::ShootPortal(EPortalType PortalType, const FVector& StartL
 	const bool bThisPortalExisted = ActivePortals[PortalType] != nullptr;
 	if (bThisPortalExisted)
 	{
+		// destroyed portal's tick function would otherwise stay among the prerequisites
+		PrimaryComponentTick.RemovePrerequisite(ActivePortals[PortalType], ActivePortals[PortalType]->PrimaryActorTick);
 		ActivePortals[PortalType]->Destroy();
 	}
 	
@@ -69,13 +73,14 @@ void UPortalComponent::ShootPortal(EPortalType PortalType, const FVector& StartL
 	FActorSpawnParameters SpawnParams;
 	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
 	TSubclassOf<APortal> PortalClass = PortalClasses[PortalType];
-	const FTransform SpawnTransform = FTransform(PortalRotation, PortalLocation);
+	const FTransform SpawnTransform = FTransform(PortalRotation, PortalLocation, FVector(PortalSurface->GetPortalScale()));
 	TObjectPtr<APortal> Portal = GetWorld()->SpawnActorDeferred<APortal>(PortalClass, SpawnTransform, nullptr, nullptr,
 	                                                                     ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
 	Portal->Initialize(PortalSurface, PortalLocalCoords, PortalExtents, PortalType, OtherPortal);
 	UGameplayStatics::FinishSpawningActor(Portal, SpawnTransform);
 
 	ActivePortals[PortalType] = Portal;
+	PrimaryComponentTick.AddPrerequisite(Portal, Portal->PrimaryActorTick);
 
 	if (OtherPortal)
 	{
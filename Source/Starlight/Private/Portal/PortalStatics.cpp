@@ -3,8 +3,11 @@
 
 #include "Portal/PortalStatics.h"
 
+#include "Components/MeshComponent.h"
+#include "Materials/MaterialInstanceDynamic.h"
 #include "Portal/Portal.h"
 #include "Portal/PortalSurface.h"
+#include "Portal/TeleportableCopy.h"
 
 namespace Constants
 {
@@ -113,46 +116,106 @@ bool UPortalStatics::LineTraceThroughPortal(TObjectPtr<UWorld> World,
 	return false;
 }
 
-EPortalType UPortalStatics::GetOtherPortalType(EPortalType PortalType)
+bool UPortalStatics::OverlapSphereThroughPortal(TObjectPtr<UWorld> World,
+                                                TArray<FOverlapResult>& OutOverlaps,
+                                                TObjectPtr<const APortal> Portal,
+                                                const FVector& Center,
+                                                float Radius,
+                                                const FCollisionObjectQueryParams& ObjectQueryParams,
+                                                FCollisionQueryParams QueryParams)
 {
-	return PortalType == EPortalType::First ? EPortalType::Second : EPortalType::First;
+	OutOverlaps.Reset();
+	const APortal* OtherPortal = Portal ? Portal->GetConnectedPortal().Get() : nullptr;
+	if (!OtherPortal)
+	{
+		return false;
+	}
+
+	// sphere has to reach the portal rectangle itself, not just its plane beside it on the wall
+	const FTransform& PortalTransform = Portal->GetActorTransform();
+	const FVector LocalCenter = PortalTransform.InverseTransformPosition(Center);
+	const FVector LocalClosestPoint = {0.f, FMath::Clamp(LocalCenter.Y, -PortalConstants::HalfSize.Y, PortalConstants::HalfSize.Y),
+	                                   FMath::Clamp(LocalCenter.Z, -PortalConstants::HalfSize.Z, PortalConstants::HalfSize.Z)};
+	if (FVector::DistSquared(Center, PortalTransform.TransformPosition(LocalClosestPoint)) > FMath::Square(Radius))
+	{
+		return false;
+	}
+
+	TArray<TObjectPtr<AActor>> PortalSurfaceActors;
+	OtherPortal->GetPortalSurface()->GetCollisionActors(PortalSurfaceActors);
+	QueryParams.AddIgnoredActors(PortalSurfaceActors);
+	QueryParams.AddIgnoredActor(OtherPortal);
+
+	const FVector TeleportedCenter = Portal->TeleportLocation(Center);
+	const FCollisionShape Sphere = FCollisionShape::MakeSphere(Radius * Portal->GetSizeRatio());
+	World->OverlapMultiByObjectType(OutOverlaps, TeleportedCenter, FQuat::Identity, ObjectQueryParams, Sphere, QueryParams);
+
+	// only the part of the teleported sphere in front of the other portal is seen through it
+	const FVector OtherPortalLocation = OtherPortal->GetActorLocation();
+	const FVector OtherPortalNormal = OtherPortal->GetActorForwardVector();
+	OutOverlaps.RemoveAll([&OtherPortalLocation, &OtherPortalNormal](const FOverlapResult& Overlap)
+	{
+		const UPrimitiveComponent* Component = Overlap.GetComponent();
+		if (!Component)
+		{
+			return true;
+		}
+
+		const FBoxSphereBounds& Bounds = Component->Bounds;
+		return FVector::PointPlaneDist(Bounds.Origin, OtherPortalLocation, OtherPortalNormal) +
+		       FVector::BoxPushOut(OtherPortalNormal, Bounds.BoxExtent) <= 0.f;
+	});
+	return OutOverlaps.Num() > 0;
 }
 
-ECollisionChannel UPortalStatics::GetCopyObjectType(EPortalType PortalType)
+EPortalType UPortalStatics::GetOtherPortalType(EPortalType PortalType)
 {
-	return PortalType == EPortalType::First ? ECC_FirstPortalCopy : ECC_SecondPortalCopy;
+	return PortalType == EPortalType::First ? EPortalType::Second : EPortalType::First;
 }
 
-ECollisionChannel UPortalStatics::GetOpposingCopyObjectType(EPortalType PortalType)
+UMaterialInstanceDynamic* GetCullPlaneMaterial(TObjectPtr<UPrimitiveComponent> Component)
 {
-	return PortalType == EPortalType::First ? ECC_SecondPortalCopy : ECC_FirstPortalCopy;
+	return Component->GetNumMaterials() > 0 ? Cast<UMaterialInstanceDynamic>(Component->GetMaterial(0)) : nullptr;
 }
 
-ECollisionChannel UPortalStatics::GetInnerObjectTypeForPortalType(EPortalType PortalType)
+void UPortalStatics::CreateCullPlaneMaterial(TObjectPtr<UMeshComponent> Component)
 {
-	return PortalType == EPortalType::First ? ECC_WithinFirstPortal : ECC_SecondPortalCopy;
+	if (Component->GetNumMaterials() == 0)
+	{
+		return;
+	}
+
+	if (UMaterialInstanceDynamic* Instance = GetCullPlaneMaterial(Component))
+	{
+		// instance may be left from a different mesh, the slot is cleared to see which material the mesh has there
+		Component->SetMaterial(0, nullptr);
+		if (Instance->Parent == Component->GetMaterial(0))
+		{
+			Component->SetMaterial(0, Instance);
+			return;
+		}
+	}
+
+	Component->CreateAndSetMaterialInstanceDynamic(0);
 }
 
-ECollisionChannel UPortalStatics::GetObjectTypeOnOverlapBegin(TObjectPtr<ITeleportable> Teleportable, EPortalType PortalType)
+void UPortalStatics::SetCullPlane(TObjectPtr<UPrimitiveComponent> Component, const FVector& CullPlaneCenter,
+                                  const FVector& CullPlaneNormal)
 {
-	ECollisionChannel CurrentObjectType = Teleportable->GetCollisionComponent()->GetCollisionObjectType();
-	if (PortalType == EPortalType::First)
+	if (UMaterialInstanceDynamic* Instance = GetCullPlaneMaterial(Component))
 	{
-		return CurrentObjectType == ECC_WithinSecondPortal ? ECC_WithinBothPortals : ECC_WithinFirstPortal;
+		Instance->SetScalarParameterValue(PortalConstants::CanBeCulledParam, PortalConstants::FloatTrue);
+		Instance->SetVectorParameterValue(PortalConstants::CullPlaneCenterParam, CullPlaneCenter);
+		Instance->SetVectorParameterValue(PortalConstants::CullPlaneNormalParam, CullPlaneNormal);
 	}
-	
-	return CurrentObjectType == ECC_WithinFirstPortal ? ECC_WithinBothPortals : ECC_WithinSecondPortal;
 }
 
-ECollisionChannel UPortalStatics::GetObjectTypeOnOverlapEnd(TObjectPtr<ITeleportable> Teleportable, EPortalType PortalType)
+void UPortalStatics::ClearCullPlane(TObjectPtr<UPrimitiveComponent> Component)
 {
-	ECollisionChannel CurrentObjectType = Teleportable->GetCollisionComponent()->GetCollisionObjectType();
-	if (CurrentObjectType == ECC_WithinBothPortals)
+	if (UMaterialInstanceDynamic* Instance = GetCullPlaneMaterial(Component))
 	{
-		return PortalType == EPortalType::First ? ECC_WithinSecondPortal : ECC_WithinFirstPortal;
+		Instance->SetScalarParameterValue(PortalConstants::CanBeCulledParam, PortalConstants::FloatFalse);
 	}
-
-	return Teleportable->GetTeleportableBaseObjectType();
 }
 
 bool CanComponentEncroachTeleportingActor(TObjectPtr<UPrimitiveComponent> OverlapComponent,
@@ -165,7 +228,7 @@ bool CanComponentEncroachTeleportingActor(TObjectPtr<UPrimitiveComponent> Overla
 		return false;
 	}
 	
-	if (TeleportingCopyTypes.Contains(OverlapComponent->GetCollisionObjectType()))
+	if (Cast<ATeleportableCopy>(OverlapComponent->GetOwner()))
 	{
 		return true;
 	}
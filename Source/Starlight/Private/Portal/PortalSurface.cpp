@@ -24,6 +24,11 @@ bool APortalSurface::CanFitPortal() const
 	return bCanFitPortal;
 }
 
+float APortalSurface::GetPortalScale() const
+{
+	return PortalScale;
+}
+
 bool APortalSurface::GetPortalLocation(const FHitResult& HitResult, FVector& OutLocation, FVector& OutLocalCoords,
                                        FVector& OutExtents, FRotator& OutRotation)
 {
@@ -32,19 +37,20 @@ bool APortalSurface::GetPortalLocation(const FHitResult& HitResult, FVector& Out
 		return false;
 	}
 
+	const FVector PortalHalfSize = PortalConstants::HalfSize * PortalScale;
 	const FTransform Transform = GetActorTransform();
 	OutLocalCoords = bPortalOnlyInCenter ? FVector::ZeroVector : Transform.InverseTransformPositionNoScale(HitResult.Location);
 
 	if (bFixedOrientation)
 	{
-		const float YLimit = Extents.Y - PortalConstants::HalfSize.Y;
-		const float ZLimit = Extents.Z - PortalConstants::HalfSize.Z;
+		const float YLimit = Extents.Y - PortalHalfSize.Y;
+		const float ZLimit = Extents.Z - PortalHalfSize.Z;
 		OutLocalCoords.Y = FMath::Clamp(OutLocalCoords.Y, -YLimit, YLimit);
 		OutLocalCoords.Z = FMath::Clamp(OutLocalCoords.Z, -ZLimit, ZLimit);
 
 		OutLocation = Transform.TransformPositionNoScale(OutLocalCoords) + HitResult.Normal *
 			PortalConstants::OffsetFromSurface;
-		OutExtents = PortalConstants::HalfSize;
+		OutExtents = PortalHalfSize;
 		OutRotation = GetActorRotation();
 	}
 	else
@@ -52,10 +58,8 @@ bool APortalSurface::GetPortalLocation(const FHitResult& HitResult, FVector& Out
 		const FVector TraceDir = HitResult.TraceEnd - HitResult.TraceStart;
 		const FVector Projection = FVector::VectorPlaneProject(TraceDir, GetActorForwardVector());
 		const FVector LocalProjection = Transform.TransformVectorNoScale(Projection.GetSafeNormal());
-		float YExtent = FMath::Lerp(PortalConstants::HalfSize.Y, PortalConstants::HalfSize.Z,
-		                            FMath::Abs(LocalProjection.Y));
-		float ZExtent = FMath::Lerp(PortalConstants::HalfSize.Y, PortalConstants::HalfSize.Z,
-		                            FMath::Abs(LocalProjection.Z));
+		float YExtent = FMath::Lerp(PortalHalfSize.Y, PortalHalfSize.Z, FMath::Abs(LocalProjection.Y));
+		float ZExtent = FMath::Lerp(PortalHalfSize.Y, PortalHalfSize.Z, FMath::Abs(LocalProjection.Z));
 
 		if (Extents.Y < YExtent || Extents.Z < ZExtent)
 		{
@@ -108,7 +112,8 @@ void APortalSurface::BeginPlay()
 	{
 		Size = StaticMesh->GetBoundingBox().GetSize() * GetActorScale();
 		Extents = Size / 2.f;
-		bCanFitPortal = Size.Y >= PortalConstants::Size.Y && Size.Z >= PortalConstants::Size.Z;
+		const FVector PortalSize = PortalConstants::Size * PortalScale;
+		bCanFitPortal = Size.Y >= PortalSize.Y && Size.Z >= PortalSize.Z;
 	}
 	else
 	{
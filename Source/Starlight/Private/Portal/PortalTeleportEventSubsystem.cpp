@@ -0,0 +1,131 @@
+﻿// Shadowhoof Games, 2022
+
+
+#include "Portal/PortalTeleportEventSubsystem.h"
+
+#include "Portal/Portal.h"
+#include "Portal/PortalConstants.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Portal teleport event dispatch"), STAT_PortalTeleportDispatch, STATGROUP_Portal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Portal teleport events"), STAT_PortalTeleportEvents, STATGROUP_Portal);
+
+
+void UPortalTeleportEventSubsystem::Deinitialize()
+{
+	Listeners.Empty();
+	PendingEvents.Empty();
+	DispatchedEvents.Empty();
+
+	Super::Deinitialize();
+}
+
+void UPortalTeleportEventSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	DispatchPendingEvents();
+}
+
+TStatId UPortalTeleportEventSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPortalTeleportEventSubsystem, STATGROUP_Portal);
+}
+
+void UPortalTeleportEventSubsystem::QueueTeleportEvent(TObjectPtr<AActor> Actor, TObjectPtr<APortal> SourcePortal,
+                                                       TObjectPtr<APortal> TargetPortal)
+{
+	if (!Actor || !SourcePortal)
+	{
+		return;
+	}
+
+	FPortalTeleportEvent& Event = PendingEvents.AddDefaulted_GetRef();
+	Event.Actor = Actor;
+	Event.SourcePortal = SourcePortal;
+	Event.TargetPortal = TargetPortal;
+	INC_DWORD_STAT(STAT_PortalTeleportEvents);
+}
+
+FDelegateHandle UPortalTeleportEventSubsystem::Subscribe(TObjectPtr<const AActor> Actor,
+                                                         FPortalTeleportEventDelegate::FDelegate&& Delegate)
+{
+	if (!Actor)
+	{
+		return FDelegateHandle();
+	}
+
+	return Listeners.FindOrAdd(Actor.Get()).Add(MoveTemp(Delegate));
+}
+
+void UPortalTeleportEventSubsystem::Unsubscribe(TObjectPtr<const AActor> Actor, FDelegateHandle& Handle)
+{
+	FPortalTeleportEventDelegate* Delegate = Actor ? Listeners.Find(Actor.Get()) : nullptr;
+	if (Delegate)
+	{
+		Delegate->Remove(Handle);
+
+		// delegate might be broadcasting right now, so it can only be removed once dispatch is over
+		if (!Delegate->IsBound())
+		{
+			if (bIsDispatching)
+			{
+				bHasUnboundListeners = true;
+			}
+			else
+			{
+				Listeners.Remove(Actor.Get());
+			}
+		}
+	}
+
+	Handle.Reset();
+}
+
+void UPortalTeleportEventSubsystem::DispatchPendingEvents()
+{
+	if (PendingEvents.Num() == 0 || bIsDispatching)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_PortalTeleportDispatch);
+	bIsDispatching = true;
+	while (PendingEvents.Num() > 0)
+	{
+		Swap(PendingEvents, DispatchedEvents);
+		for (const FPortalTeleportEvent& Event : DispatchedEvents)
+		{
+			// copy so that listeners subscribing to other actors during broadcast can't invalidate it
+			if (const FPortalTeleportEventDelegate* Delegate = Event.Actor.IsValid() ? Listeners.Find(Event.Actor.Get()) : nullptr)
+			{
+				const FPortalTeleportEventDelegate DelegateCopy = *Delegate;
+				DelegateCopy.Broadcast(Event);
+			}
+		}
+		DispatchedEvents.Reset();
+	}
+	bIsDispatching = false;
+
+	if (bHasUnboundListeners)
+	{
+		RemoveUnboundListeners();
+	}
+}
+
+bool UPortalTeleportEventSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPortalTeleportEventSubsystem::RemoveUnboundListeners()
+{
+	for (auto It = Listeners.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().IsBound())
+		{
+			It.RemoveCurrent();
+		}
+	}
+	bHasUnboundListeners = false;
+}
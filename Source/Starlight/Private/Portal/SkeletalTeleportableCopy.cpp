@@ -14,6 +14,8 @@ ASkeletalTeleportableCopy::ASkeletalTeleportableCopy()
 	
 	SkeletalMeshComponent = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("MeshComponent"));
 	SkeletalMeshComponent->SetupAttachment(CapsuleComponent);
+	SkeletalMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SkeletalMeshComponent->bEnableUpdateRateOptimizations = true;
 	
 	RootComponent = CapsuleComponent;
 }
@@ -28,14 +30,40 @@ void ASkeletalTeleportableCopy::Initialize(TObjectPtr<ITeleportable> InParent, T
 	float CapsuleRadius, CapsuleHalfHeight;
 	ParentCapsule->GetScaledCapsuleSize(CapsuleRadius, CapsuleHalfHeight);
 	CapsuleComponent->SetCapsuleSize(CapsuleRadius, CapsuleHalfHeight);
-	CapsuleComponent->SetCollisionResponseToChannels(ParentCapsule->GetCollisionResponseToChannels());
+	SetupCopyCollision(CapsuleComponent, ParentCapsule);
 
 	ParentMeshComponent = Character->GetMesh();
 	SkeletalMeshComponent->SetSkeletalMesh(ParentMeshComponent->SkeletalMesh);
 	SkeletalMeshComponent->SetRelativeTransform(ParentMeshComponent->GetRelativeTransform());
+	if (bUseLeaderPose)
+	{
+		// bone transforms are copied from parent after it is ticked so animation is only evaluated once
+		SkeletalMeshComponent->bUseBoundsFromMasterPoseComponent = true;
+		SkeletalMeshComponent->SetMasterPoseComponent(ParentMeshComponent.Get(), true);
+	}
+	else
+	{
+		SkeletalMeshComponent->VisibilityBasedAnimTickOption = AnimTickOption;
+		SkeletalMeshComponent->SetAnimInstanceClass(ParentMeshComponent->GetAnimClass());
+	}
 
 	DisableCollisionWithPortal(CapsuleComponent);
-	CreateDynamicInstances(SkeletalMeshComponent);
+	SetCulledMeshComponent(SkeletalMeshComponent);
+}
+
+void ASkeletalTeleportableCopy::Park()
+{
+	Super::Park();
+
+	if (bUseLeaderPose)
+	{
+		SkeletalMeshComponent->SetMasterPoseComponent(nullptr);
+	}
+	else
+	{
+		SkeletalMeshComponent->SetAnimInstanceClass(nullptr);
+	}
+	ParentMeshComponent = nullptr;
 }
 
 bool ASkeletalTeleportableCopy::IsHiddenInPortal() const
@@ -5,14 +5,18 @@
 
 #include "Portal/CopyStaticMeshComponent.h"
 #include "Portal/Portal.h"
-#include "Portal/PortalStatics.h"
+#include "Portal/PortalCollisionSubsystem.h"
 
 
 AStaticTeleportableCopy::AStaticTeleportableCopy()
 {
+	// copy is a kinematic body which only mirrors its parent, it is never simulated on its own
 	StaticMeshComponent = CreateDefaultSubobject<UCopyStaticMeshComponent>(TEXT("StaticMeshComponent"));
-	StaticMeshComponent->SetSimulatePhysics(true);
+	StaticMeshComponent->SetSimulatePhysics(false);
+	StaticMeshComponent->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 	StaticMeshComponent->SetNotifyRigidBodyCollision(true);
+	// copy follows its parent every frame, overlap updates for those moves would be wasted
+	StaticMeshComponent->SetGenerateOverlapEvents(false);
 	RootComponent = StaticMeshComponent;
 }
 
@@ -24,37 +28,44 @@ void AStaticTeleportableCopy::Initialize(TObjectPtr<ITeleportable> InParent, TOb
 	StaticMeshComponent->SetStaticMesh(ParentMeshComponent->GetStaticMesh());
 
 	UPrimitiveComponent* ParentCollisionComponent = InParent->GetCollisionComponent();
-	StaticMeshComponent->SetCollisionObjectType(UPortalStatics::GetCopyObjectType(InOwnerPortal->GetPortalType()));
+	SetupCopyCollision(StaticMeshComponent, ParentCollisionComponent);
 	StaticMeshComponent->SetMassOverrideInKg(NAME_None, ParentCollisionComponent->GetBodyInstance()->GetBodyMass());
 	StaticMeshComponent->SetLinkedComponent(ParentCollisionComponent);
 
-	StaticMeshComponent->SetCollisionResponseToChannels(ParentCollisionComponent->GetCollisionResponseToChannels());
-	StaticMeshComponent->SetCollisionResponseToChannel(ECC_GrabObstruction, ECR_Ignore);
-
 	DisableCollisionWithPortal(StaticMeshComponent);
-	CreateDynamicInstances(StaticMeshComponent);
+	SetCulledMeshComponent(StaticMeshComponent);
+
+	InOwnerPortal->GetConnectedPortal()->SetCollisionMaskBit(StaticMeshComponent, EPortalCollisionMaskType::Copy, true);
+	OnPortalMoved();
 }
 
-void AStaticTeleportableCopy::ResetVelocity()
+void AStaticTeleportableCopy::Park()
 {
-	StaticMeshComponent->SetPhysicsLinearVelocity(FVector::ZeroVector);
-	StaticMeshComponent->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
+	Super::Park();
+
+	StaticMeshComponent->SetLinkedComponent(nullptr);
 }
 
-void AStaticTeleportableCopy::DispatchPhysicsCollisionHit(const FRigidBodyCollisionInfo& MyInfo,
-													const FRigidBodyCollisionInfo& OtherInfo,
-													const FCollisionImpactData& RigidCollisionData)
+void AStaticTeleportableCopy::ClearPortalCollision()
 {
-	Super::DispatchPhysicsCollisionHit(MyInfo, OtherInfo, RigidCollisionData);
+	Super::ClearPortalCollision();
+
+	if (UPortalCollisionSubsystem* CollisionSubsystem = GetWorld()->GetSubsystem<UPortalCollisionSubsystem>())
+	{
+		CollisionSubsystem->ClearMask(StaticMeshComponent);
+		CollisionSubsystem->RemoveCopyLink(StaticMeshComponent);
+	}
+	StaticMeshComponent->SetDrivenOnPhysicsThread(false);
+}
 
-	// for now only collide with certain object types because otherwise we'll be constantly colliding with the floor and
-	// propagating that force to the parent
-	static const TSet PropagatedObjectTypes = {ECC_PhysicsBody, ECC_Pawn, ECC_WithinFirstPortal, ECC_WithinSecondPortal, ECC_WithinBothPortals};
-	if (OtherInfo.Component.IsValid() && PropagatedObjectTypes.Contains(OtherInfo.Component->GetCollisionObjectType()))
+void AStaticTeleportableCopy::OnPortalMoved()
+{
+	if (UPortalCollisionSubsystem* CollisionSubsystem = GetWorld()->GetSubsystem<UPortalCollisionSubsystem>();
+		CollisionSubsystem && ParentActor)
 	{
-		const FVector TotalImpulse = RigidCollisionData.TotalNormalImpulse;
-		const FRigidBodyContactInfo& Contact = RigidCollisionData.ContactInfos[0];
-		const FVector Impulse = Contact.ContactNormal.Dot(TotalImpulse.GetSafeNormal()) > 0.f ? TotalImpulse : -TotalImpulse;
-		StaticMeshComponent->OnPhysicsImpulseApplied(Impulse, Contact.ContactPosition);
+		ITeleportable* Parent = Cast<ITeleportable>(ParentActor);
+		const bool bIsLinked = CollisionSubsystem->SetCopyLink(StaticMeshComponent, Parent->GetCollisionComponent(),
+		                                                       OwnerPortal->GetPairTransform());
+		StaticMeshComponent->SetDrivenOnPhysicsThread(bIsLinked);
 	}
 }
@@ -4,11 +4,12 @@
 #include "Portal/Teleportable.h"
 
 #include "Portal/Portal.h"
+#include "Portal/PortalCollisionSubsystem.h"
 #include "Portal/PortalConstants.h"
 #include "Portal/PortalStatics.h"
 #include "Portal/PortalSurface.h"
 #include "Portal/TeleportableCopy.h"
-#include "Statics/StarlightStatics.h"
+#include "Portal/TeleportableCopyPool.h"
 
 
 void ITeleportable::Teleport(TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal)
@@ -19,8 +20,16 @@ void ITeleportable::Teleport(TObjectPtr<APortal> SourcePortal, TObjectPtr<APorta
 	
 	FVector LinearVelocity, AngularVelocity;
 	GetTeleportVelocity(LinearVelocity, AngularVelocity);
-	const FVector NewLinearVelocity = SourcePortal->TeleportVelocity(LinearVelocity);
-	const FVector NewAngularVelocity = SourcePortal->TeleportVelocity(AngularVelocity);
+	const FVector NewLinearVelocity = SourcePortal->TeleportVelocity(LinearVelocity, AsActor->GetActorLocation());
+	const FVector NewAngularVelocity = SourcePortal->TeleportAngularVelocity(AngularVelocity);
+
+	// scale has to be applied before encroachment check so the check uses the final shape
+	const FVector OldScale = AsActor->GetActorScale3D();
+	const float SizeRatio = SourcePortal->GetSizeRatio();
+	if (IsScaledByPortals() && !FMath::IsNearlyEqual(SizeRatio, 1.f))
+	{
+		AsActor->SetActorScale3D(OldScale * SizeRatio);
+	}
 
 	FVector Adjustment;
 	TArray<TObjectPtr<AActor>> IgnoredActors;
@@ -31,9 +40,8 @@ void ITeleportable::Teleport(TObjectPtr<APortal> SourcePortal, TObjectPtr<APorta
 		IgnoredActors.Add(Copy);
 	}
 	
-	const ECollisionChannel ObjectTypeToCheck = UPortalStatics::GetInnerObjectTypeForPortalType(TargetPortal->GetPortalType());
 	const bool bIsEncroaching = UPortalStatics::ComponentEncroachesBlockingGeometryOnTeleport(AsActor, GetCollisionComponent(),
-		NewLocation, NewRotation, IgnoredActors, Adjustment, TargetPortal, ObjectTypeToCheck);
+		NewLocation, NewRotation, IgnoredActors, Adjustment, TargetPortal);
 	if (bIsEncroaching)
 	{
 		UE_LOG(LogPortal, Verbose, TEXT("%s is encroaching into other objects during teleport, making adjustment to push it out: %s"),
@@ -45,6 +53,7 @@ void ITeleportable::Teleport(TObjectPtr<APortal> SourcePortal, TObjectPtr<APorta
 	if (!bHasTeleported)
 	{
 		UE_LOG(LogPortal, Error, TEXT("Actor %s failed to teleport"), *AsActor->GetName());
+		AsActor->SetActorScale3D(OldScale);
 		return;
 	}
 
@@ -53,37 +62,24 @@ void ITeleportable::Teleport(TObjectPtr<APortal> SourcePortal, TObjectPtr<APorta
 
 void ITeleportable::EnableCollisionWith(TObjectPtr<APortalSurface> PortalSurface)
 {
-	const TObjectPtr<UPrimitiveComponent> TeleportableComponent = GetCollisionComponent();
-	if (TeleportableComponent)
+	if (UPortalCollisionSubsystem* CollisionSubsystem = PortalSurface->GetWorld()->GetSubsystem<UPortalCollisionSubsystem>())
 	{
-		TArray<TObjectPtr<UPrimitiveComponent>> SurfaceCollisionComponents;
-		PortalSurface->GetCollisionComponents(SurfaceCollisionComponents);
-		for (UPrimitiveComponent* SurfaceComponent : SurfaceCollisionComponents)
-		{
-			UStarlightStatics::EnableCollisionBetween(SurfaceComponent, TeleportableComponent);
-		}
-	}
-	else
-	{
-		UE_LOG(LogPortal, Warning, TEXT("No collision component set up for %s"), *CastToTeleportableActor()->GetName())
+		CollisionSubsystem->RestorePortalSurface(GetCollisionComponent(), PortalSurface);
 	}
 }
 
 void ITeleportable::DisableCollisionWith(TObjectPtr<APortalSurface> PortalSurface)
 {
 	const TObjectPtr<UPrimitiveComponent> TeleportableComponent = GetCollisionComponent();
-	if (TeleportableComponent)
+	if (!TeleportableComponent)
 	{
-		TArray<TObjectPtr<UPrimitiveComponent>> SurfaceCollisionComponents;
-		PortalSurface->GetCollisionComponents(SurfaceCollisionComponents);
-		for (UPrimitiveComponent* SurfaceComponent : SurfaceCollisionComponents)
-		{
-			UStarlightStatics::DisableCollisionBetween(SurfaceComponent, TeleportableComponent);
-		}
+		UE_LOG(LogPortal, Warning, TEXT("No collision component set up for %s"), *CastToTeleportableActor()->GetName())
+		return;
 	}
-	else
+
+	if (UPortalCollisionSubsystem* CollisionSubsystem = PortalSurface->GetWorld()->GetSubsystem<UPortalCollisionSubsystem>())
 	{
-		UE_LOG(LogPortal, Warning, TEXT("No collision component set up for %s"), *CastToTeleportableActor()->GetName())
+		CollisionSubsystem->IgnorePortalSurface(TeleportableComponent, PortalSurface);
 	}
 }
 
@@ -99,32 +95,16 @@ TObjectPtr<const AActor> ITeleportable::CastToTeleportableActor() const
 
 void ITeleportable::OnOverlapWithPortalBegin(TObjectPtr<APortal> Portal)
 {
-	UPrimitiveComponent* CollisionComponent = GetCollisionComponent();
-	
-	ECollisionChannel NewObjectType = UPortalStatics::GetObjectTypeOnOverlapBegin(this, Portal->GetPortalType());
-	UE_LOG(LogPortal, VeryVerbose, TEXT("Portal %s overlap begin | Setting object type of %s to %s"), *Portal->GetName(),
-							*CastToTeleportableActor()->GetName(), *UEnum::GetValueAsName(NewObjectType).ToString())
-	CollisionComponent->SetCollisionObjectType(NewObjectType);
-	
 	UE_LOG(LogPortal, Verbose, TEXT("Portal %s is now overlapping with %s"), *Portal->GetName(), *CastToTeleportableActor()->GetName());
 	DisableCollisionWith(Portal->GetPortalSurface());
-
-	const ECollisionChannel ObjectTypeToBlock = UPortalStatics::GetOpposingCopyObjectType(Portal->GetPortalType());
-	CollisionComponent->SetCollisionResponseToChannel(ObjectTypeToBlock, ECR_Block);
+	Portal->SetCollisionMaskBit(GetCollisionComponent(), EPortalCollisionMaskType::Inner, true);
 }
 
 void ITeleportable::OnOverlapWithPortalEnd(TObjectPtr<APortal> Portal)
 {
 	UE_LOG(LogPortal, Verbose, TEXT("Portal %s is no longer overlapping with %s"), *Portal->GetName(), *CastToTeleportableActor()->GetName());
 	EnableCollisionWith(Portal->GetPortalSurface());
-
-	const ECollisionChannel ObjectTypeToIgnore = UPortalStatics::GetOpposingCopyObjectType(Portal->GetPortalType());
-	UPrimitiveComponent* CollisionComponent = GetCollisionComponent();
-	CollisionComponent->SetCollisionResponseToChannel(ObjectTypeToIgnore, ECR_Ignore);
-
-	ECollisionChannel NewObjectType = UPortalStatics::GetObjectTypeOnOverlapEnd(this, Portal->GetPortalType());
-	UE_LOG(LogPortal, VeryVerbose, TEXT("Portal %s overlap end | Setting object type of %s to %s"), *Portal->GetName(), *CastToTeleportableActor()->GetName(), *UEnum::GetValueAsName(NewObjectType).ToString())
-	CollisionComponent->SetCollisionObjectType(NewObjectType);
+	Portal->SetCollisionMaskBit(GetCollisionComponent(), EPortalCollisionMaskType::Inner, false);
 }
 
 TScriptInterface<ITeleportable> ITeleportable::GetTeleportableScriptInterface()
@@ -145,22 +125,17 @@ FVector ITeleportable::GetTeleportableObjectLocation() const
 	return CastToTeleportableActor()->GetActorLocation();
 }
 
-void ITeleportable::GetTeleportVelocity(FVector& LinearVelocity, FVector& AngularVelocity) const
+bool ITeleportable::IsScaledByPortals() const
 {
+	return true;
 }
 
-void ITeleportable::SetTeleportVelocity(const FVector& LinearVelocity, const FVector& AngularVelocity)
-{
-}
-
-void ITeleportable::OnTeleportableMoved()
+void ITeleportable::GetTeleportVelocity(FVector& LinearVelocity, FVector& AngularVelocity) const
 {
 }
 
-ECollisionChannel ITeleportable::GetTeleportableBaseObjectType()
+void ITeleportable::SetTeleportVelocity(const FVector& LinearVelocity, const FVector& AngularVelocity)
 {
-	UE_LOG(LogPortal, Error, TEXT("ITeleportable::GetBaseObjectType is not implemented for %s"), *CastToTeleportableActor()->GetClass()->GetName());
-	return ECC_PhysicsBody;
 }
 
 TObjectPtr<ATeleportableCopy> ITeleportable::CreatePortalCopy(const FTransform& SpawnTransform,
@@ -173,10 +148,12 @@ TObjectPtr<ATeleportableCopy> ITeleportable::CreatePortalCopy(const FTransform&
 		return nullptr;
 	}
 
-	FActorSpawnParameters SpawnParams;
-	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-	ATeleportableCopy* Copy = OwnerPortal->GetWorld()->SpawnActor<ATeleportableCopy>(CopyClass, SpawnTransform, SpawnParams);
-	Copy->Initialize(this, OwnerPortal);
+	UTeleportableCopyPool* CopyPool = OwnerPortal->GetWorld()->GetSubsystem<UTeleportableCopyPool>();
+	ATeleportableCopy* Copy = CopyPool ? CopyPool->AcquireCopy(CopyClass, SpawnTransform) : nullptr;
+	if (Copy)
+	{
+		Copy->Initialize(this, OwnerPortal);
+	}
 	return Copy;
 }
 
@@ -3,10 +3,11 @@
 
 #include "Portal/TeleportableCopy.h"
 
+#include "Core/StarlightConstants.h"
 #include "Portal/Portal.h"
 #include "Portal/PortalConstants.h"
+#include "Portal/PortalStatics.h"
 #include "Portal/PortalSurface.h"
-#include "Statics/StarlightStatics.h"
 
 
 ATeleportableCopy::ATeleportableCopy()
@@ -17,14 +18,29 @@ void ATeleportableCopy::Initialize(TObjectPtr<ITeleportable> InParent, TObjectPt
 {
 	OwnerPortal = InOwnerPortal;
 	ParentActor = InParent->CastToTeleportableActor();
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	SetActorTickEnabled(true);
+}
+
+void ATeleportableCopy::Park()
+{
+	ClearPortalCollision();
+
+	OwnerPortal = nullptr;
+	ParentActor = nullptr;
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
 }
 
 void ATeleportableCopy::UpdateCullingParams(const FVector& CullPlaneCenter, const FVector& CullPlaneNormal)
 {
-	for (UMaterialInstanceDynamic* Instance : DynamicMaterialInstances)
+	if (CulledMeshComponent)
 	{
-		Instance->SetVectorParameterValue(PortalConstants::CullPlaneCenterParam, CullPlaneCenter);
-		Instance->SetVectorParameterValue(PortalConstants::CullPlaneNormalParam, CullPlaneNormal);
+		UPortalStatics::SetCullPlane(CulledMeshComponent, CullPlaneCenter, CullPlaneNormal);
 	}
 }
 
@@ -33,8 +49,9 @@ TObjectPtr<AActor> ATeleportableCopy::GetParent() const
 	return ParentActor;
 }
 
-void ATeleportableCopy::ResetVelocity()
+void ATeleportableCopy::FollowParent(const FTransform& NewTransform)
 {
+	SetActorTransform(NewTransform, false, nullptr, ETeleportType::None);
 }
 
 TWeakObjectPtr<APortal> ATeleportableCopy::GetOwnerPortal() const
@@ -47,24 +64,51 @@ bool ATeleportableCopy::IsHiddenInPortal() const
 	return false;
 }
 
-void ATeleportableCopy::DisableCollisionWithPortal(TObjectPtr<UPrimitiveComponent> CollisionComponent)
+void ATeleportableCopy::OnPortalMoved()
 {
-	TArray<TObjectPtr<UPrimitiveComponent>> SurfaceCollisionComponents;
-	OwnerPortal->GetConnectedPortal()->GetPortalSurface()->GetCollisionComponents(SurfaceCollisionComponents);
-	for (UPrimitiveComponent* SurfaceCollisionComponent : SurfaceCollisionComponents)
+}
+
+void ATeleportableCopy::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ClearPortalCollision();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ATeleportableCopy::ClearPortalCollision()
+{
+	if (UPortalCollisionSubsystem* CollisionSubsystem = GetWorld()->GetSubsystem<UPortalCollisionSubsystem>())
 	{
-		UStarlightStatics::DisableCollisionBetween(SurfaceCollisionComponent, CollisionComponent);
+		CollisionSubsystem->RemoveIgnoreCollision(PortalSurfaceIgnoreHandle);
 	}
 }
 
-void ATeleportableCopy::CreateDynamicInstances(TObjectPtr<UMeshComponent> MeshComponent)
+void ATeleportableCopy::DisableCollisionWithPortal(TObjectPtr<UPrimitiveComponent> CollisionComponent)
 {
-	const int32 MaterialCount = MeshComponent->GetMaterials().Num();
-	DynamicMaterialInstances.Reset(MaterialCount);
-	for (int32 Index = 0; Index < MaterialCount; ++Index)
+	UPortalCollisionSubsystem* CollisionSubsystem = GetWorld()->GetSubsystem<UPortalCollisionSubsystem>();
+	if (!CollisionSubsystem)
 	{
-		UMaterialInstanceDynamic* Instance = MeshComponent->CreateAndSetMaterialInstanceDynamic(Index);
-		Instance->SetScalarParameterValue(PortalConstants::CanBeCulledParam, PortalConstants::FloatTrue);
-		DynamicMaterialInstances.Add(Instance);
+		return;
 	}
+
+	TArray<TObjectPtr<UPrimitiveComponent>> SurfaceCollisionComponents;
+	OwnerPortal->GetConnectedPortal()->GetPortalSurface()->GetCollisionComponents(SurfaceCollisionComponents);
+	PortalSurfaceIgnoreHandle = CollisionSubsystem->AddIgnoreCollision(CollisionComponent, SurfaceCollisionComponents);
+}
+
+void ATeleportableCopy::SetupCopyCollision(TObjectPtr<UPrimitiveComponent> CollisionComponent,
+                                           TObjectPtr<const UPrimitiveComponent> ParentCollisionComponent)
+{
+	CollisionComponent->SetCollisionObjectType(ECC_PortalCopy);
+	CollisionComponent->SetCollisionResponseToChannels(ParentCollisionComponent->GetCollisionResponseToChannels());
+	CollisionComponent->SetCollisionResponseToChannel(ECC_Visibility, ECR_Ignore);
+	CollisionComponent->SetCollisionResponseToChannel(ECC_Camera, ECR_Ignore);
+	CollisionComponent->SetCollisionResponseToChannel(ECC_Portal, ECR_Ignore);
+	CollisionComponent->SetCollisionResponseToChannel(ECC_GrabObstruction, ECR_Ignore);
+}
+
+void ATeleportableCopy::SetCulledMeshComponent(TObjectPtr<UMeshComponent> MeshComponent)
+{
+	CulledMeshComponent = MeshComponent;
+	UPortalStatics::CreateCullPlaneMaterial(MeshComponent);
 }
@@ -0,0 +1,155 @@
+﻿// Shadowhoof Games, 2022
+
+
+#include "Portal/TeleportableCopyPool.h"
+
+#include "EngineUtils.h"
+#include "Portal/PortalConstants.h"
+#include "Portal/Teleportable.h"
+#include "Portal/TeleportableCopy.h"
+
+
+static TAutoConsoleVariable CVarPortalCopyPool(
+                                               TEXT("Portal.CopyPool"),
+                                               true,
+                                               TEXT("Reuses parked teleportable copies instead of spawning and destroying them"));
+
+static TAutoConsoleVariable CVarPortalCopyPoolMaxParked(
+                                                        TEXT("Portal.CopyPoolMaxParked"),
+                                                        16,
+                                                        TEXT("Maximum number of parked copies kept per copy class, copies released beyond it are destroyed"));
+
+DECLARE_CYCLE_STAT(TEXT("Acquire teleportable copy"), STAT_PortalCopyAcquire, STATGROUP_Portal);
+DECLARE_CYCLE_STAT(TEXT("Release teleportable copy"), STAT_PortalCopyRelease, STATGROUP_Portal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Teleportable copies spawned"), STAT_PortalCopiesSpawned, STATGROUP_Portal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Teleportable copies reused"), STAT_PortalCopiesReused, STATGROUP_Portal);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Parked teleportable copies"), STAT_PortalParkedCopies, STATGROUP_Portal);
+
+
+void UTeleportableCopyPool::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (!CVarPortalCopyPool.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	TSet<TSubclassOf<ATeleportableCopy>> CopyClasses;
+	for (TActorIterator<AActor> It(&InWorld); It; ++It)
+	{
+		if (const ITeleportable* Teleportable = Cast<ITeleportable>(*It))
+		{
+			if (const TSubclassOf<ATeleportableCopy> CopyClass = Teleportable->GetPortalCopyClass())
+			{
+				CopyClasses.Add(CopyClass);
+			}
+		}
+	}
+
+	for (const TSubclassOf<ATeleportableCopy>& CopyClass : CopyClasses)
+	{
+		Prewarm(CopyClass, PortalConstants::CopyPoolPrewarmCount);
+	}
+}
+
+TObjectPtr<ATeleportableCopy> UTeleportableCopyPool::AcquireCopy(TSubclassOf<ATeleportableCopy> CopyClass,
+                                                                 const FTransform& Transform)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PortalCopyAcquire);
+	if (!CopyClass)
+	{
+		return nullptr;
+	}
+
+	FTeleportableCopyPoolBucket* Bucket = ParkedCopies.Find(CopyClass);
+	while (Bucket && Bucket->Copies.Num() > 0)
+	{
+		ATeleportableCopy* Copy = Bucket->Copies.Pop(false);
+		if (IsValid(Copy))
+		{
+			INC_DWORD_STAT(STAT_PortalCopiesReused);
+			UpdatePooledCopyStat();
+			Copy->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+			return Copy;
+		}
+	}
+
+	INC_DWORD_STAT(STAT_PortalCopiesSpawned);
+	return SpawnCopy(CopyClass, Transform);
+}
+
+void UTeleportableCopyPool::ReleaseCopy(TObjectPtr<ATeleportableCopy> Copy)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PortalCopyRelease);
+	if (!IsValid(Copy))
+	{
+		return;
+	}
+
+	// after a burst of crossings only a bounded number of copies is kept around
+	TArray<TObjectPtr<ATeleportableCopy>>& Copies = ParkedCopies.FindOrAdd(Copy->GetClass()).Copies;
+	if (!CVarPortalCopyPool.GetValueOnGameThread() || Copies.Num() >= CVarPortalCopyPoolMaxParked.GetValueOnGameThread())
+	{
+		Copy->Destroy();
+		return;
+	}
+
+	Copy->Park();
+	Copies.Add(Copy);
+	UpdatePooledCopyStat();
+}
+
+void UTeleportableCopyPool::Prewarm(TSubclassOf<ATeleportableCopy> CopyClass, int32 Count)
+{
+	if (!CopyClass)
+	{
+		return;
+	}
+
+	TArray<TObjectPtr<ATeleportableCopy>>& Copies = ParkedCopies.FindOrAdd(CopyClass).Copies;
+	Count = FMath::Min(Count, CVarPortalCopyPoolMaxParked.GetValueOnGameThread());
+	while (Copies.Num() < Count)
+	{
+		ATeleportableCopy* Copy = SpawnCopy(CopyClass, FTransform::Identity);
+		if (!Copy)
+		{
+			break;
+		}
+
+		Copy->Park();
+		Copies.Add(Copy);
+	}
+
+	UpdatePooledCopyStat();
+}
+
+bool UTeleportableCopyPool::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TObjectPtr<ATeleportableCopy> UTeleportableCopyPool::SpawnCopy(TSubclassOf<ATeleportableCopy> CopyClass,
+                                                               const FTransform& Transform) const
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	ATeleportableCopy* Copy = GetWorld()->SpawnActor<ATeleportableCopy>(CopyClass, Transform, SpawnParams);
+	if (!Copy)
+	{
+		UE_LOG(LogPortal, Error, TEXT("Failed to spawn teleportable copy of class %s"), *GetNameSafe(CopyClass));
+	}
+	return Copy;
+}
+
+void UTeleportableCopyPool::UpdatePooledCopyStat() const
+{
+#if STATS
+	int32 ParkedCount = 0;
+	for (const auto& Entry : ParkedCopies)
+	{
+		ParkedCount += Entry.Value.Copies.Num();
+	}
+	SET_DWORD_STAT(STAT_PortalParkedCopies, ParkedCount);
+#endif
+}
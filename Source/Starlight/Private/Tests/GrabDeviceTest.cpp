@@ -0,0 +1,148 @@
+﻿// Shadowhoof Games, 2022
+
+
+#include "Misc/AutomationTest.h"
+#include "Core/StarlightActor.h"
+#include "Core/StarlightCharacter.h"
+#include "GameFramework/PlayerController.h"
+#include "Grab/GrabDevice.h"
+#include "Tests/StarlightTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+static TArray<FGrabPoseSample> MakeGrabPoseSamples(int32 Count, double FrameTime, const FVector& LinearVelocity,
+                                                   const FVector& AngularVelocity)
+{
+	// latest sample first, like the ring buffer is read back
+	const FQuat StartRotation(FRotator(20.f, 45.f, 0.f));
+	TArray<FGrabPoseSample> Samples;
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const double Time = 10.0 - Index * FrameTime;
+		FGrabPoseSample& Sample = Samples.AddDefaulted_GetRef();
+		Sample.Time = Time;
+		Sample.Location = FVector(100.f, 0.f, 50.f) + LinearVelocity * Time;
+		Sample.Rotation = FQuat::MakeFromRotationVector(AngularVelocity * Time) * StartRotation;
+	}
+	return Samples;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGrabReleaseVelocityTest, "Starlight.Grab.ReleaseVelocity.Fit",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FGrabReleaseVelocityTest::RunTest(const FString& Parameters)
+{
+	constexpr double FrameTime = 1.0 / 90.0;
+	const FVector LinearVelocity(250.f, -80.f, 120.f);
+	const FVector AngularVelocity(0.f, 2.f, -3.f);
+
+	FVector FittedLinearVelocity;
+	FVector FittedAngularVelocity;
+	TArray<FGrabPoseSample> Samples = MakeGrabPoseSamples(GrabConstants::ReleaseVelocitySampleCount, FrameTime,
+	                                                      LinearVelocity, AngularVelocity);
+	TestTrue(TEXT("Velocity is fitted to a full buffer"), UGrabDevice::FitPoseVelocity(Samples, FittedLinearVelocity, FittedAngularVelocity));
+	TestTrue(TEXT("Linear velocity of steady motion is recovered"), FittedLinearVelocity.Equals(LinearVelocity, 0.1f));
+	TestTrue(TEXT("Angular velocity of steady spin is recovered"), FittedAngularVelocity.Equals(AngularVelocity, 0.01f));
+
+	// jitter of a tracked hand averages out instead of following the last frame
+	for (int32 Index = 0; Index < Samples.Num(); ++Index)
+	{
+		Samples[Index].Location.X += Index % 2 == 0 ? 0.2f : -0.2f;
+	}
+	UGrabDevice::FitPoseVelocity(Samples, FittedLinearVelocity, FittedAngularVelocity);
+	const double LastFrameSpeedX = (Samples[0].Location.X - Samples[1].Location.X) / FrameTime;
+	TestTrue(TEXT("Jitter changes the fit less than the last frame difference"),
+	         FMath::Abs(FittedLinearVelocity.X - LinearVelocity.X) < FMath::Abs(LastFrameSpeedX - LinearVelocity.X));
+
+	// samples from before the window don't affect the fit
+	Samples = MakeGrabPoseSamples(GrabConstants::ReleaseVelocitySampleCount, GrabConstants::ReleaseVelocityWindow / 3.0,
+	                              LinearVelocity, AngularVelocity);
+	for (int32 Index = 4; Index < Samples.Num(); ++Index)
+	{
+		Samples[Index].Location = FVector::ZeroVector;
+	}
+	TestTrue(TEXT("Velocity is fitted to samples within the window"),
+	         UGrabDevice::FitPoseVelocity(Samples, FittedLinearVelocity, FittedAngularVelocity));
+	TestTrue(TEXT("Samples older than the window are ignored"), FittedLinearVelocity.Equals(LinearVelocity, 0.1f));
+
+	TestFalse(TEXT("Single sample gives no velocity"),
+	          UGrabDevice::FitPoseVelocity(MakeArrayView(Samples.GetData(), 1), FittedLinearVelocity, FittedAngularVelocity));
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGrabViewOffsetTest, "Starlight.Grab.TickOrder.HeldObjectFollowsTurnSameFrame",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FGrabViewOffsetTest::RunTest(const FString& Parameters)
+{
+	constexpr float TurnStep = 30.f;
+	constexpr float TurnRate = 90.f;
+	const FVector HeldOffset(150.f, 0.f, 0.f);
+
+	FStarlightTestWorld TestWorld;
+	UWorld* World = TestWorld.Get();
+	TestWorld.SpawnFloor();
+
+	// character only creates its grab devices when it is possessed by a player controller on begin play
+	const FTransform CharacterTransform(FVector(0.f, 0.f, 100.f));
+	APlayerController* Controller = World->SpawnActor<APlayerController>();
+	AStarlightCharacter* Character = World->SpawnActorDeferred<AStarlightCharacter>(
+		AStarlightCharacter::StaticClass(), CharacterTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	Controller->Possess(Character);
+	Character->FinishSpawning(CharacterTransform);
+	UGrabDevice* GrabDevice = Character->GetGrabDevice(EControllerHand::Special_1);
+	if (!TestNotNull(TEXT("Character has a trace grab device"), GrabDevice))
+	{
+		return false;
+	}
+
+	for (int32 Frame = 0; Frame < 30; ++Frame)
+	{
+		TestWorld.Tick();
+	}
+
+	const FTransform ObjectTransform(FRotator::ZeroRotator, Character->GetViewTransform().TransformPosition(HeldOffset),
+	                                 FVector(0.2f));
+	AStarlightActor* Object = TestWorld.SpawnMeshActor<AStarlightActor>(ObjectTransform, FStarlightTestWorld::GetCubeMesh());
+	TestWorld.Tick();
+	if (!TestTrue(TEXT("Object in front of the view is grabbed"), GrabDevice->TryGrabbing()))
+	{
+		return false;
+	}
+
+	for (int32 Frame = 0; Frame < 60; ++Frame)
+	{
+		TestWorld.Tick();
+	}
+
+	// held object has settled, so it only moves during the next frame if its target follows the turn in the same frame
+	float Yaw = Controller->GetControlRotation().Yaw + TurnStep;
+	Controller->SetControlRotation(FRotator(0.f, Yaw, 0.f));
+	const FVector LocationBeforeTurn = Object->GetActorLocation();
+	TestWorld.Tick();
+	const FVector TurnedTarget = Character->GetViewTransform().TransformPosition(HeldOffset);
+	const double MovedTowardTarget = (Object->GetActorLocation() - LocationBeforeTurn).Dot(
+		(TurnedTarget - LocationBeforeTurn).GetSafeNormal());
+	TestTrue(FString::Printf(TEXT("Held object moves toward the turned view in the same frame, moved %.2f"), MovedTowardTarget),
+	         MovedTowardTarget > 1.0);
+
+	// steady turn, offset in view is how far physics handle lets the object trail behind the view
+	double MaxOffsetError = 0.0;
+	for (int32 Frame = 0; Frame < 30; ++Frame)
+	{
+		Yaw += TurnRate * StarlightTests::DeltaTime;
+		Controller->SetControlRotation(FRotator(0.f, Yaw, 0.f));
+		TestWorld.Tick();
+
+		const FVector RenderedOffset = Character->GetViewTransform().InverseTransformPosition(Object->GetActorLocation());
+		MaxOffsetError = FMath::Max(MaxOffsetError, FVector::Distance(RenderedOffset, HeldOffset));
+	}
+	AddInfo(FString::Printf(TEXT("Max held object offset error in view while turning: %.2f"), MaxOffsetError));
+
+	TestTrue(TEXT("Object is still held after turning"), GrabDevice->GetGrabbedObject() != nullptr);
+	return true;
+}
+
+#endif
@@ -0,0 +1,106 @@
+﻿// Shadowhoof Games, 2022
+
+
+#include "Misc/AutomationTest.h"
+#include "Core/StarlightActor.h"
+#include "Portal/Portal.h"
+#include "Portal/PortalCollisionFilter.h"
+#include "Portal/TeleportableCopy.h"
+#include "Tests/StarlightTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalCopyPredictionTest, "Starlight.Portal.CollisionFilter.CopyFollowsParentWithoutLag",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalCopyPredictionTest::RunTest(const FString& Parameters)
+{
+	using StarlightTests::DeltaTime;
+	using StarlightTests::PairTransform;
+
+	// parent moving in a straight line ends the step exactly where copy's target is mirrored from
+	const FTransform ParentTransform(FRotator(10.f, 20.f, 0.f), FVector(100.f, 50.f, 20.f));
+	const FVector Velocity(300.f, -120.f, 40.f);
+	const FTransform Predicted = FPortalCollisionFilterCallback::PredictTransform(ParentTransform, FVector::ZeroVector,
+	                                                                              Velocity, FVector::ZeroVector, DeltaTime);
+	const FTransform ParentAfterStep(ParentTransform.GetRotation(), ParentTransform.GetLocation() + Velocity * DeltaTime);
+	TestTrue(TEXT("Copy target matches parent after a step of linear motion"),
+	         (Predicted * PairTransform).Equals(ParentAfterStep * PairTransform, KINDA_SMALL_NUMBER));
+
+	// spinning parent keeps its center of mass in place while its origin swings around it
+	const FVector LocalCenterOfMass(0.f, 0.f, 50.f);
+	const FVector AngularVelocity(PI, 0.f, 0.f);
+	const FTransform Spun = FPortalCollisionFilterCallback::PredictTransform(ParentTransform, LocalCenterOfMass,
+	                                                                         FVector::ZeroVector, AngularVelocity, DeltaTime);
+	TestTrue(TEXT("Center of mass stays in place when parent only rotates"),
+	         Spun.TransformPosition(LocalCenterOfMass).Equals(ParentTransform.TransformPosition(LocalCenterOfMass), 0.01f));
+	TestFalse(TEXT("Parent rotation is integrated"), Spun.GetRotation().Equals(ParentTransform.GetRotation(), KINDA_SMALL_NUMBER));
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalCopyStackingTest, "Starlight.Portal.CollisionFilter.StackingOnCopy",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalCopyStackingTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 SettleStepCount = 60;
+	constexpr int32 MeasuredStepCount = 120;
+	constexpr float BoxHalfSize = 10.f;
+
+	FStarlightTestWorld World;
+	World.SpawnFloor();
+	APortal* FirstPortal;
+	APortal* SecondPortal;
+	World.SpawnPortalPair(FirstPortal, SecondPortal);
+
+	// long parent lies on the floor mostly behind the first portal, its copy sticks out of the second portal far enough
+	// for a box to rest on it outside of the second portal's inner box, where the box doesn't get a copy of its own
+	UStaticMesh* Cube = FStarlightTestWorld::GetCubeMesh();
+	const FTransform ParentTransform(FRotator::ZeroRotator, FVector(10.f, 0.f, 50.f), FVector(3.f, 1.f, 1.f));
+	AStarlightActor* Parent = World.SpawnMeshActor<AStarlightActor>(ParentTransform, Cube);
+	World.Tick();
+
+	ATeleportableCopy* Copy = FirstPortal->RetrieveCopyForActor(Parent);
+	if (!TestNotNull(TEXT("Parent in the portal has a copy"), Copy))
+	{
+		return false;
+	}
+
+	const FTransform BoxTransform(FRotator::ZeroRotator, FVector(625.f, 0.f, 100.f + BoxHalfSize + 2.f), FVector(0.2f));
+	AStarlightActor* Box = World.SpawnMeshActor<AStarlightActor>(BoxTransform, Cube);
+	for (int32 Step = 0; Step < SettleStepCount; ++Step)
+	{
+		World.Tick();
+	}
+
+	const FVector ParentStartLocation = Parent->GetActorLocation();
+	float MaxParentDrift = 0.f;
+	float MaxPenetration = 0.f;
+	float MaxBoxSpeed = 0.f;
+	for (int32 Step = 0; Step < MeasuredStepCount; ++Step)
+	{
+		World.Tick();
+
+		const float CopyTop = Copy->GetActorLocation().Z + 50.f;
+		const float BoxBottom = Box->GetActorLocation().Z - BoxHalfSize;
+		MaxParentDrift = FMath::Max(MaxParentDrift, static_cast<float>(FVector::Dist(Parent->GetActorLocation(), ParentStartLocation)));
+		MaxPenetration = FMath::Max(MaxPenetration, CopyTop - BoxBottom);
+		MaxBoxSpeed = FMath::Max(MaxBoxSpeed, static_cast<float>(Box->GetCollisionComponent()->GetPhysicsLinearVelocity().Size()));
+	}
+
+	AddInfo(FString::Printf(TEXT("Over %d steps parent drifted %.3f, box penetrated the copy %.3f and moved at up to %.3f"),
+	                        MeasuredStepCount, MaxParentDrift, MaxPenetration, MaxBoxSpeed));
+	TestTrue(TEXT("Box resting on the copy doesn't push the parent along the floor"), MaxParentDrift < 1.f);
+	TestTrue(TEXT("Box doesn't sink into the copy"), MaxPenetration < 1.f);
+	TestTrue(TEXT("Box rests on the copy without jittering"), MaxBoxSpeed < 5.f);
+
+	// no impulse while the box is still above the copy at the end of the step
+	TestEqual(TEXT("Approaching box which doesn't touch the copy is left alone"),
+	          static_cast<float>(FPortalCollisionFilterCallback::CalculateContactSpeedChange(-100.f, 5.f, StarlightTests::DeltaTime)), 0.f);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,97 @@
+﻿// Shadowhoof Games, 2022
+
+
+#include "Misc/AutomationTest.h"
+#include "Portal/Portal.h"
+#include "Tests/StarlightTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+static void FillCopyParentTransforms(int32 Count, TArray<FTransform>& ParentTransforms, TArray<bool>& ParentScaledFlags)
+{
+	FRandomStream RandomStream(Count);
+	ParentTransforms.SetNum(Count);
+	ParentScaledFlags.SetNum(Count);
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const FRotator Rotation(RandomStream.FRandRange(-90.f, 90.f), RandomStream.FRandRange(-180.f, 180.f), 0.f);
+		const FVector Scale(RandomStream.FRandRange(0.5f, 2.f));
+		ParentTransforms[Index] = FTransform(Rotation, RandomStream.GetUnitVector() * 500.f, Scale);
+		ParentScaledFlags[Index] = Index % 2 == 0;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalCopySyncParallelTest, "Starlight.Portal.CopySync.ParallelMatchesSingleThread",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalCopySyncParallelTest::RunTest(const FString& Parameters)
+{
+	// other portal is twice as large so scale of copies differs from their parents'
+	const FTransform PairTransform(FRotator(0.f, 90.f, 0.f), FVector(300.f, -200.f, 100.f), FVector(2.f));
+
+	TArray<FTransform> ParentTransforms;
+	TArray<bool> ParentScaledFlags;
+	FillCopyParentTransforms(1000, ParentTransforms, ParentScaledFlags);
+
+	TArray<FTransform> SingleThreadTransforms;
+	TArray<FTransform> ParallelTransforms;
+	SingleThreadTransforms.SetNum(ParentTransforms.Num());
+	ParallelTransforms.SetNum(ParentTransforms.Num());
+	APortal::CalculateTransformsForCopies(PairTransform, ParentTransforms, ParentScaledFlags, SingleThreadTransforms, true);
+	APortal::CalculateTransformsForCopies(PairTransform, ParentTransforms, ParentScaledFlags, ParallelTransforms, false);
+
+	for (int32 Index = 0; Index < ParentTransforms.Num(); ++Index)
+	{
+		const FTransform Expected = APortal::CalculateTransformForCopy(PairTransform, ParentTransforms[Index], ParentScaledFlags[Index]);
+		if (!ParallelTransforms[Index].Equals(Expected, 0.f) || !SingleThreadTransforms[Index].Equals(Expected, 0.f))
+		{
+			AddError(FString::Printf(TEXT("Copy %d was not mapped through the portal pair"), Index));
+			return false;
+		}
+	}
+
+	TestTrue(TEXT("Copy of an actor scaled by portals is scaled"),
+	         ParallelTransforms[0].GetScale3D().Equals(ParentTransforms[0].GetScale3D() * 2.f, KINDA_SMALL_NUMBER));
+	TestTrue(TEXT("Copy of an actor not scaled by portals keeps its scale"),
+	         ParallelTransforms[1].GetScale3D().Equals(ParentTransforms[1].GetScale3D(), 0.f));
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalCopySyncBenchmark, "Starlight.Portal.CopySync.Benchmark",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FPortalCopySyncBenchmark::RunTest(const FString& Parameters)
+{
+	constexpr int32 RepeatCount = 100;
+
+	TArray<FTransform> ParentTransforms;
+	TArray<bool> ParentScaledFlags;
+	TArray<FTransform> CopyTransforms;
+	for (int32 CopyCount = 16; CopyCount <= 16384; CopyCount *= 4)
+	{
+		FillCopyParentTransforms(CopyCount, ParentTransforms, ParentScaledFlags);
+		CopyTransforms.SetNum(CopyCount);
+
+		double Timings[2];
+		for (int32 Mode = 0; Mode < 2; ++Mode)
+		{
+			const bool bForceSingleThread = Mode == 0;
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Repeat = 0; Repeat < RepeatCount; ++Repeat)
+			{
+				APortal::CalculateTransformsForCopies(StarlightTests::PairTransform, ParentTransforms, ParentScaledFlags, CopyTransforms,
+				                                      bForceSingleThread);
+			}
+			Timings[Mode] = (FPlatformTime::Seconds() - StartTime) * 1000000.0 / RepeatCount;
+		}
+
+		AddInfo(FString::Printf(TEXT("%5d copies: single thread %8.1f us, parallel %8.1f us"), CopyCount, Timings[0],
+		                        Timings[1]));
+	}
+
+	return true;
+}
+
+#endif
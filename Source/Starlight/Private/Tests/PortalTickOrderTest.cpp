@@ -0,0 +1,84 @@
+﻿// Shadowhoof Games, 2022
+
+
+#include "Misc/AutomationTest.h"
+#include "Core/StarlightActor.h"
+#include "Core/StarlightCharacter.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Portal/Portal.h"
+#include "Portal/PortalComponent.h"
+#include "Portal/TeleportableCopy.h"
+#include "Tests/StarlightTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalTickOrderTest, "Starlight.Portal.TickOrder.Pipeline",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalTickOrderTest::RunTest(const FString& Parameters)
+{
+	const ETickingGroup MovementGroup = GetDefault<AStarlightCharacter>()->GetCharacterMovement()->PrimaryComponentTick.TickGroup;
+	const ETickingGroup PortalGroup = GetDefault<APortal>()->PrimaryActorTick.TickGroup;
+	const ETickingGroup TeleportableGroup = GetDefault<AStarlightActor>()->PrimaryActorTick.TickGroup;
+	const ETickingGroup CaptureGroup = GetDefault<UPortalComponent>()->PrimaryComponentTick.TickGroup;
+
+	TestTrue(TEXT("Character moves and teleports before physics"), MovementGroup < TG_DuringPhysics);
+	TestTrue(TEXT("Portals teleport bodies and sync copies with this frame's physics results"), PortalGroup == TG_PostPhysics);
+	TestTrue(TEXT("Teleportables update their cull plane no earlier than portals"), TeleportableGroup >= PortalGroup);
+	TestTrue(TEXT("Portal captures are updated after everything has been teleported"), CaptureGroup > PortalGroup);
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalCopyFrameLagTest, "Starlight.Portal.TickOrder.CopyWithoutFrameLag",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalCopyFrameLagTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 FrameCount = 10;
+	const FVector Velocity(0.f, 100.f, 0.f);
+
+	FStarlightTestWorld World;
+	APortal* FirstPortal;
+	APortal* SecondPortal;
+	World.SpawnPortalPair(FirstPortal, SecondPortal);
+
+	// parent floats through the first portal along its plane, so it keeps its copy without being teleported
+	const FTransform ParentTransform(FRotator::ZeroRotator, FVector(20.f, -30.f, 125.f), FVector(0.5f));
+	AStarlightActor* Parent = World.SpawnMeshActor<AStarlightActor>(ParentTransform, FStarlightTestWorld::GetCubeMesh());
+	UPrimitiveComponent* ParentComponent = Parent->GetCollisionComponent();
+	ParentComponent->SetEnableGravity(false);
+	World.Tick();
+
+	ATeleportableCopy* Copy = FirstPortal->RetrieveCopyForActor(Parent);
+	if (!TestNotNull(TEXT("Parent in the portal has a copy"), Copy))
+	{
+		return false;
+	}
+
+	ParentComponent->SetPhysicsLinearVelocity(Velocity);
+	for (int32 Frame = 0; Frame < FrameCount; ++Frame)
+	{
+		// every frame ticks movement, physics and portals in their groups, copy has to end it mirroring the parent
+		const FVector ParentStartLocation = Parent->GetActorLocation();
+		World.Tick();
+
+		if (Parent->GetActorLocation().Equals(ParentStartLocation))
+		{
+			AddError(FString::Printf(TEXT("Parent hasn't been moved by physics on frame %d"), Frame));
+			return false;
+		}
+
+		const FTransform ParentSeenThroughCopy = Copy->GetActorTransform() * FirstPortal->GetPairTransform().Inverse();
+		const float Lag = static_cast<float>(FVector::Dist(ParentSeenThroughCopy.GetLocation(), Parent->GetActorLocation()));
+		if (Lag > 0.1f)
+		{
+			AddError(FString::Printf(TEXT("Copy is %.3f behind its moving parent on frame %d"), Lag, Frame));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,80 @@
+﻿// Shadowhoof Games, 2022
+
+
+#include "Tests/StarlightTestHelpers.h"
+
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "GameFramework/WorldSettings.h"
+#include "Portal/Portal.h"
+#include "Portal/PortalSurface.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+FStarlightTestWorld::FStarlightTestWorld()
+{
+	World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	World->bShouldSimulatePhysics = true;
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	// there is no game mode to start play, world settings start it the same way
+	if (!World->GetBegunPlay())
+	{
+		World->GetWorldSettings()->NotifyBeginPlay();
+	}
+}
+
+FStarlightTestWorld::~FStarlightTestWorld()
+{
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+}
+
+UWorld* FStarlightTestWorld::Get() const
+{
+	return World;
+}
+
+void FStarlightTestWorld::Tick(float DeltaSeconds)
+{
+	World->Tick(LEVELTICK_All, DeltaSeconds);
+}
+
+UStaticMesh* FStarlightTestWorld::GetCubeMesh()
+{
+	return LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+}
+
+void FStarlightTestWorld::SpawnFloor()
+{
+	const FTransform Transform(FRotator::ZeroRotator, FVector(0.f, 0.f, -50.f), FVector(20.f, 20.f, 1.f));
+	SpawnMeshActor<AStaticMeshActor>(Transform, GetCubeMesh());
+}
+
+void FStarlightTestWorld::SpawnPortalPair(APortal*& OutFirst, APortal*& OutSecond, const FTransform& FirstTransform,
+                                          const FTransform& SecondTransform)
+{
+	APortal* Portals[2] = {nullptr, nullptr};
+	const FTransform Transforms[2] = {FirstTransform, SecondTransform};
+	for (int32 Index = 0; Index < 2; ++Index)
+	{
+		APortalSurface* Surface = World->SpawnActor<APortalSurface>(APortalSurface::StaticClass(), Transforms[Index]);
+		Portals[Index] = World->SpawnActorDeferred<APortal>(APortal::StaticClass(), Transforms[Index], nullptr, nullptr,
+		                                                    ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+		const bool bIsFirst = Index == 0;
+		Portals[Index]->Initialize(Surface, FVector::ZeroVector, PortalConstants::HalfSize,
+		                           bIsFirst ? EPortalType::First : EPortalType::Second, bIsFirst ? nullptr : Portals[0]);
+		Portals[Index]->FinishSpawning(Transforms[Index]);
+	}
+	Portals[0]->SetConnectedPortal(Portals[1]);
+
+	OutFirst = Portals[0];
+	OutSecond = Portals[1];
+}
+
+#endif
@@ -0,0 +1,77 @@
+﻿// Shadowhoof Games, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/World.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+class APortal;
+class UStaticMesh;
+
+
+namespace StarlightTests
+{
+	const float DeltaTime = 1.f / 60.f;
+
+	/** Pair transform of the portals spawned by FStarlightTestWorld::SpawnPortalPair with their default transforms */
+	const FTransform PairTransform(FRotator(0.f, 180.f, 0.f), FVector(500.f, 0.f, 0.f));
+
+	/** Both portals face +X with bottom edge on the ground, second one 500 units further along X */
+	const FTransform FirstPortalTransform(FRotator::ZeroRotator, FVector(0.f, 0.f, 125.f));
+	const FTransform SecondPortalTransform(FRotator::ZeroRotator, FVector(500.f, 0.f, 125.f));
+}
+
+
+/**
+ * Game world which is created for a single test and destroyed with this object. It is only ticked by the test, so
+ * actors go through the same tick groups and physics steps as in game without waiting for real frames.
+ */
+class FStarlightTestWorld
+{
+public:
+
+	FStarlightTestWorld();
+	~FStarlightTestWorld();
+
+	FStarlightTestWorld(const FStarlightTestWorld&) = delete;
+	FStarlightTestWorld& operator=(const FStarlightTestWorld&) = delete;
+
+	UWorld* Get() const;
+
+	/** Ticks the whole world once, physics included. */
+	void Tick(float DeltaSeconds = StarlightTests::DeltaTime);
+
+	/** Engine cube, 100 units on each side. */
+	static UStaticMesh* GetCubeMesh();
+
+	/** Spawns an actor and gives its static mesh component the mesh before the actor begins play. */
+	template <typename TActor>
+	TActor* SpawnMeshActor(const FTransform& Transform, UStaticMesh* Mesh)
+	{
+		TActor* Actor = World->SpawnActorDeferred<TActor>(TActor::StaticClass(), Transform, nullptr, nullptr,
+		                                                  ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+		if (UStaticMeshComponent* MeshComponent = Actor->template FindComponentByClass<UStaticMeshComponent>())
+		{
+			MeshComponent->SetStaticMesh(Mesh);
+		}
+		Actor->FinishSpawning(Transform);
+		return Actor;
+	}
+
+	/** Spawns a static floor 2000 units wide with its top at zero height. */
+	void SpawnFloor();
+
+	/** Spawns two connected portals on surfaces without collision, the same way portal component places them. */
+	void SpawnPortalPair(APortal*& OutFirst, APortal*& OutSecond,
+	                     const FTransform& FirstTransform = StarlightTests::FirstPortalTransform,
+	                     const FTransform& SecondTransform = StarlightTests::SecondPortalTransform);
+
+private:
+
+	UWorld* World = nullptr;
+};
+
+#endif
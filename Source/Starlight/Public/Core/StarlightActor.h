@@ -28,8 +28,6 @@ public:
 	
 	virtual bool IsGrabbed() const override;
 
-	virtual void OnGrabbableMoved(const float Speed) override;
-
 	// Grabbable interface end 
 
 	// Teleportable interface begin
@@ -46,21 +44,12 @@ public:
 	virtual void GetTeleportVelocity(FVector& LinearVelocity, FVector& AngularVelocity) const override;
 	virtual void SetTeleportVelocity(const FVector& LinearVelocity, const FVector& AngularVelocity) override;
 
-	virtual ECollisionChannel GetTeleportableBaseObjectType() override;
-
 	// Teleportable interface end
-	
-	virtual void NotifyHit(UPrimitiveComponent* MyComp, AActor* Other, UPrimitiveComponent* OtherComp, bool bSelfMoved,
-	                       FVector HitLocation, FVector HitNormal, FVector NormalImpulse,
-	                       const FHitResult& Hit) override;
 
 protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "StaticMesh")
 	TObjectPtr<UStaticMeshComponent> MeshComponent;
 
-	UPROPERTY()
-	TObjectPtr<UMaterialInstanceDynamic> DynamicMaterialInstance;
-
 protected:
 	virtual void BeginPlay() override;
 
@@ -70,8 +59,6 @@ private:
 
 	bool bIsGrabbed = false;
 
-	float GrabbedMovementSpeed = 0.f;
-
 private:
 	void UpdateMaterialParameters();
 };
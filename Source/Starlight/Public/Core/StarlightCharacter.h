@@ -16,6 +16,50 @@ class UMotionControllerComponent;
 class UCameraComponent;
 class USphereComponent;
 class UGrabDevice;
+class AStarlightCharacter;
+
+
+/** Grab devices holding a single object. */
+USTRUCT()
+struct FHeldObjectState
+{
+	GENERATED_BODY()
+
+	/** Devices in the order they grabbed the object, the first one drives the object */
+	UPROPERTY()
+	TArray<TObjectPtr<UGrabDevice>> Devices;
+
+	/** Collisions ignored between the held object and the character, shared by all holding devices */
+	FPortalIgnoreCollisionHandle IgnoreHandle;
+};
+
+
+/**
+ * Ticks character's grab devices at the end of pre physics, once character movement and motion controllers have their
+ * final transforms for the frame. Held objects are moved by physics handles, so their targets have to be set before
+ * physics runs for held objects to follow the view the frame is rendered with instead of lagging a frame behind.
+ */
+USTRUCT()
+struct FGrabDevicesTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	AStarlightCharacter* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread,
+	                         const FGraphEventRef& MyCompletionGraphEvent) override;
+
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FGrabDevicesTickFunction> : public TStructOpsTypeTraitsBase2<FGrabDevicesTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
 
 
 UENUM(BlueprintType)
@@ -43,6 +87,14 @@ public:
 
 	TObjectPtr<UCameraComponent> GetCameraComponent() const;
 
+	/** Returns camera transform with the HMD pose or control rotation the view is going to be rendered with this frame. */
+	FTransform GetViewTransform() const;
+
+	const FGrabDevicesTickFunction& GetGrabDevicesTick() const;
+
+	/** Returns device grabbing with the hand, trace grab device uses Special_1. Null if there is no such device. */
+	TObjectPtr<UGrabDevice> GetGrabDevice(EControllerHand Hand) const;
+
 	/**
 	 *	Gets forward vector that can be used for movement. With motion controllers movement forward vector
 	 *	can differ from actor forward vector.
@@ -57,8 +109,22 @@ public:
 
 	virtual void Tick(float DeltaSeconds) override;
 
-	void OnObjectGrabbed(TObjectPtr<IGrabbable> Grabbable);
-	void OnObjectReleased(TObjectPtr<IGrabbable> Grabbable);
+	virtual void RegisterActorTickFunctions(bool bRegister) override;
+
+	void TickGrabDevices(float DeltaSeconds);
+
+	/**
+	 * Registers device as holding the object. Object is set up for being held when the first device grabs it and
+	 * released when the last one lets go, hands holding the same object share that setup.
+	 */
+	void OnObjectGrabbed(TObjectPtr<IGrabbable> Grabbable, TObjectPtr<UGrabDevice> Device);
+	void OnObjectReleased(TObjectPtr<IGrabbable> Grabbable, TObjectPtr<UGrabDevice> Device);
+
+	/** Returns devices holding the object, the first one drives it. */
+	const TArray<TObjectPtr<UGrabDevice>>& GetObjectHolders(TObjectPtr<IGrabbable> Grabbable) const;
+
+	/** Returns portals the character is close enough to reach through. */
+	const TArray<TObjectPtr<APortal>>& GetOverlappingPortals() const;
 	
 	// Teleportable interface begin
 
@@ -73,12 +139,10 @@ public:
 	virtual void SetTeleportVelocity(const FVector& LinearVelocity, const FVector& AngularVelocity) override;
 
 	virtual FVector GetTeleportableObjectLocation() const override;
-	
-	virtual void OnTeleportableMoved() override;
 
-	virtual TSubclassOf<ATeleportableCopy> GetPortalCopyClass() const override;
+	virtual bool IsScaledByPortals() const override;
 
-	virtual ECollisionChannel GetTeleportableBaseObjectType() override;
+	virtual TSubclassOf<ATeleportableCopy> GetPortalCopyClass() const override;
 
 	// Teleportable interface end
 
@@ -120,9 +184,15 @@ private:
 	UPROPERTY(Transient)
 	TMap<EControllerHand, TObjectPtr<UGrabDevice>> GrabDevices;
 
+	FGrabDevicesTickFunction GrabDevicesTick;
+
 	UPROPERTY()
 	TArray<TObjectPtr<APortal>> OverlappingPortals;
 
+	/** Objects held by any of the grab devices */
+	UPROPERTY(Transient)
+	TMap<TObjectPtr<AActor>, FHeldObjectState> HeldObjects;
+
 	FQuat PostTeleportInitialQuat;
 	float PostTeleportRotationProgress = 0.f;
 	bool bIsPostTeleportRotation = false;
@@ -2,7 +2,13 @@
 
 namespace GrabConstants
 {
-	const float GrabImpulseMultiplier = 0.01f;
+	/* release velocity is fitted to the last few held object poses within a time window */
+	constexpr int32 ReleaseVelocitySampleCount = 8;
+	const float ReleaseVelocityWindow = 0.15f;
 
-	const float ReleaseLinearVelocityMultiplier = 0.5f;
+	/* physics handle which steers grabbed objects */
+	const float HandleLinearStiffness = 1500.f;
+	const float HandleLinearDamping = 200.f;
+	const float HandleAngularStiffness = 3000.f;
+	const float HandleAngularDamping = 500.f;
 }
\ No newline at end of file
@@ -3,11 +3,26 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "GrabConstants.h"
+#include "Containers/StaticArray.h"
 #include "GrabDevice.generated.h"
 
 
 class AStarlightCharacter;
+class APortal;
 class IGrabbable;
+class UPhysicsHandleComponent;
+class UPortalTeleportEventSubsystem;
+struct FPortalTeleportEvent;
+
+
+/** Pose of held object at a point in time, in the space on holder's side of any portals. */
+struct FGrabPoseSample
+{
+	FVector Location = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	double Time = 0.0;
+};
 
 UCLASS(Abstract)
 class STARLIGHT_API UGrabDevice : public UObject
@@ -21,13 +36,33 @@ public:
 
 	virtual bool TryGrabbing();
 	
-	/** Tries to grab provided object */
-	virtual bool Grab(TObjectPtr<IGrabbable> ObjectToGrab);
+	/**
+	 * Tries to grab provided object
+	 * @param ObjectToGrab object to grab
+	 * @param ThroughPortals portals between the device and the object, in the order they are crossed from device's side
+	 */
+	virtual bool Grab(TObjectPtr<IGrabbable> ObjectToGrab, const TArray<TObjectPtr<APortal>>& ThroughPortals = {});
 
 	/** Releases grabbed object if any is grabbed */
 	virtual void Release();
 
 	virtual void Tick(const float DeltaSeconds);
+
+	/** Whether this device can hold an object together with another device, e.g. with two hands. */
+	virtual bool SupportsSharedGrab() const;
+
+	/**
+	 * Called on the device which drives grabbed object whenever the set of devices holding the object changes.
+	 * Takes over the physics handle if needed and captures object transform relative to the holding devices.
+	 */
+	void OnHoldersChanged();
+
+	/**
+	 * Fits linear and angular (radians) velocity to poses ordered from the latest one back with least squares.
+	 * Only poses within release velocity window are used. Returns false if there aren't at least two of them.
+	 */
+	static bool FitPoseVelocity(TConstArrayView<FGrabPoseSample> Samples, FVector& OutLinearVelocity,
+	                            FVector& OutAngularVelocity);
 	
 protected:
 
@@ -39,11 +74,89 @@ protected:
 
 	UPROPERTY()
 	TObjectPtr<USceneComponent> OwnerComponent;
+
+	/** Steers grabbed object towards its target transform while it keeps simulating */
+	UPROPERTY(Transient)
+	TObjectPtr<UPhysicsHandleComponent> PhysicsHandle;
+
+	/** Grabbed object transform relative to the component it's attached to, captured on grab */
+	FTransform GrabbedObjectRelativeTransform;
+
+	/** Grabbed object transform relative to the frame between this and the second holding device */
+	FTransform TwoHandedRelativeTransform;
+
+	/** Portals between the device and grabbed object */
+	UPROPERTY()
+	TArray<TWeakObjectPtr<APortal>> HeldThroughPortals;
+
+	/** Transform from device's side of the portal chain to grabbed object's side */
+	FTransform HeldChainTransform;
+
+	/**
+	 * For each portal in HeldThroughPortals, transform from grabbed object's side back to the side in front of that
+	 * portal. Has one more entry than there are portals, the last one is identity.
+	 */
+	TArray<FTransform> HeldChainInverseTransforms;
+
+	/** False if one of the portals in the chain was destroyed or disconnected */
+	bool bIsHeldChainValid = true;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UPortalTeleportEventSubsystem> TeleportEventSubsystem;
+
+	/** Subscriptions to teleports of the owner character and of grabbed object */
+	FDelegateHandle OwnerTeleportHandle;
+	FDelegateHandle GrabbedObjectTeleportHandle;
+
+	/** Ring buffer of recent held object poses used to estimate release velocity */
+	TStaticArray<FGrabPoseSample, GrabConstants::ReleaseVelocitySampleCount> PoseSamples;
+	int32 PoseSampleCount = 0;
+	int32 NextPoseSampleIndex = 0;
 	
 	virtual void OnSuccessfulGrab(TObjectPtr<IGrabbable> ObjectToGrab);
 
+	/**
+	 * Returns transform grabbed object should be moved to. By default object keeps the transform relative to the
+	 * component it's attached to which it had when it was grabbed.
+	 */
+	virtual bool GetGrabTargetTransform(FTransform& OutTransform) const;
+
 	virtual void OnSuccessfulRelease();
 	
 	virtual TObjectPtr<USceneComponent> GetComponentToAttachTo() const;
+
+	/** Returns whether this device drives the grabbed object, as opposed to only helping another device hold it. */
+	bool IsPrimaryHolder() const;
+
+	/** Composes transforms of all portals the object is held through. Called once per frame and whenever the chain changes. */
+	void UpdateHeldChainTransforms();
+
+	/** Called every frame while holding an object, before it's steered. Returns false if the object should be released. */
+	virtual bool UpdateHoldState(const float DeltaSeconds);
+
+	virtual void OnGrabbedObjectTeleported(TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal);
+	virtual void OnOwnerCharacterTeleported(TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal);
+
+	/** Forgets recorded poses, e.g. when the space they were recorded in is no longer valid. */
+	void ResetPoseSamples();
+
+private:
+
+	void OnOwnerTeleportEvent(const FPortalTeleportEvent& Event);
+	void OnGrabbedObjectTeleportEvent(const FPortalTeleportEvent& Event);
+
+	/** Whether the object is held through the same portals as by this device */
+	bool IsHeldThroughSamePortals(const TArray<TObjectPtr<APortal>>& ThroughPortals) const;
+
+	/** Frame centered between two holding devices with X axis pointing from this device to the other one */
+	FTransform GetTwoHandedFrame(TObjectPtr<const UGrabDevice> OtherDevice) const;
+
+	void RecordPoseSample();
+
+	/**
+	 * Fits linear and angular velocity to recorded poses with least squares, results are in grabbed object's space.
+	 * Returns false if there aren't enough recent samples.
+	 */
+	bool EstimateReleaseVelocity(FVector& OutLinearVelocity, FVector& OutAngularVelocity) const;
 	
 };
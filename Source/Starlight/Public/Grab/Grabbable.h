@@ -40,7 +40,5 @@ public:
 
 	TObjectPtr<AActor> CastToGrabbableActor();
 	TObjectPtr<const AActor> CastToGrabbableActor() const;
-
-	virtual void OnGrabbableMoved(const float Speed);
 	
 };
@@ -4,13 +4,38 @@
 
 #include "CoreMinimal.h"
 #include "GrabDevice.h"
+#include "WorldCollision.h"
 #include "MotionControllerGrabDevice.generated.h"
 
 
+class APortal;
+class USphereComponent;
+class UStaticMeshComponent;
 class UMotionControllerComponent;
 
+
+/** Component near the controller which resolves to a grabbable object, possibly on the other side of a portal */
+USTRUCT()
+struct FMotionControllerGrabCandidate
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TWeakObjectPtr<UPrimitiveComponent> Component;
+
+	/** Portal the controller reaches through to get to the grabbable object, null if it's on controller's side */
+	UPROPERTY()
+	TWeakObjectPtr<APortal> Portal;
+
+	/** Squared distance from the controller on the component's side of the portal */
+	float DistanceSquared = 0.f;
+};
+
+
 /**
- *  Grab device which is using motion controllers to grab things.
+ *  Grab device which is using motion controllers to grab things. Keeps track of grabbable objects near the controller
+ *  all the time so grabbing doesn't need any queries. Objects behind a portal are only queried for while the controller
+ *  reaches into it.
  */
 UCLASS()
 class STARLIGHT_API UMotionControllerGrabDevice : public UGrabDevice
@@ -23,12 +48,65 @@ public:
 
 	virtual bool TryGrabbing() override;
 
+	virtual void Tick(const float DeltaSeconds) override;
+
+	virtual bool SupportsSharedGrab() const override;
+
 protected:
 
 	virtual TObjectPtr<USceneComponent> GetComponentToAttachTo() const override;
+
+	virtual void OnSuccessfulGrab(TObjectPtr<IGrabbable> ObjectToGrab) override;
 	
 private:
 
-	FCollisionShape GrabTraceShape;
+	/** Overlaps grabbable objects near the controller, copies don't generate overlaps */
+	UPROPERTY(Transient)
+	TObjectPtr<USphereComponent> ProximitySphere;
+
+	/** Components overlapping proximity sphere which resolve to a grabbable object */
+	UPROPERTY(Transient)
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> OverlappingComponents;
+
+	/** Overlapping components and grabbable objects reached through portals, closest first */
+	UPROPERTY(Transient)
+	TArray<FMotionControllerGrabCandidate> GrabCandidates;
+
+	/** Scratch buffer for queries through portals, kept between frames to avoid allocations */
+	TArray<FOverlapResult> PortalOverlaps;
+
+	/** Candidate which is currently highlighted */
+	UPROPERTY(Transient)
+	TWeakObjectPtr<UPrimitiveComponent> HighlightedCandidate;
+
+	/** Outline around the highlighted candidate, drawn with a slightly larger copy of its mesh turned inside out */
+	UPROPERTY(Transient)
+	TObjectPtr<UStaticMeshComponent> HighlightComponent;
+
+private:
+
+	UFUNCTION()
+	void OnProximityBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
+	                             UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep,
+	                             const FHitResult& SweepResult);
+
+	UFUNCTION()
+	void OnProximityEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
+	                           UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+
+	/** Returns grabbable object the component belongs to. */
+	static TObjectPtr<IGrabbable> ResolveGrabbable(TObjectPtr<UPrimitiveComponent> Component);
+
+	/**
+	 * Rebuilds candidates from overlapping components and objects behind portals the controller reaches into, sorted
+	 * by distance to the controller.
+	 */
+	void UpdateGrabCandidates();
+
+	/** Adds candidates on the other side of the portal if the proximity sphere reaches through it. */
+	void AddCandidatesThroughPortal(TObjectPtr<APortal> Portal);
+
+	/** Outlines the candidate, only static mesh candidates can be outlined. */
+	void SetHighlightedCandidate(TObjectPtr<UPrimitiveComponent> Candidate);
 	
 };
@@ -8,7 +8,6 @@
 
 class AStarlightCharacter;
 class APortal;
-class ITeleportable;
 
 /**
  *  Grab device which uses ray cast to figure out what to grab
@@ -21,10 +20,6 @@ class STARLIGHT_API UTraceGrabDevice : public UGrabDevice
 public:
 
 	virtual bool TryGrabbing() override;
-
-	virtual void Initialize(TObjectPtr<USceneComponent> InOwnerComponent) override;
-
-	virtual void Tick(const float DeltaSeconds) override;
 	
 protected:
 
@@ -32,26 +27,29 @@ protected:
 
 	virtual void OnSuccessfulRelease() override;
 
-private:
+	virtual bool GetGrabTargetTransform(FTransform& OutTransform) const override;
 
-	/** Portals between trace device and grabbed object */
-	UPROPERTY()
-	TArray<TWeakObjectPtr<APortal>> HeldThroughPortals;
+	virtual bool UpdateHoldState(const float DeltaSeconds) override;
+
+	virtual void OnGrabbedObjectTeleported(TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal) override;
+	virtual void OnOwnerCharacterTeleported(TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal) override;
+
+private:
 
 	bool bIsPendingRelease = false;
 	float ReleaseDelay = 0.f;
+
+	/** Result of the last line of sight check, checks are throttled and feed the release delay */
+	bool bHasLineOfSight = true;
+	bool bIsSightCheckForced = true;
+	float TimeSinceSightCheck = 0.f;
 	
 private:
 
 	FVector GetDesiredGrabbedObjectLocation() const;
 
-	void OnActorTeleported(TObjectPtr<ITeleportable> Actor, TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal);
-	
-	void OnGrabbedObjectTeleported(TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal);
-	void OnOwnerCharacterTeleported(TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal);
-
 	bool ShouldKeepHoldingObject() const;
 
-	FQuat GetDesiredGrabbedObjectRotation();
+	FQuat GetDesiredGrabbedObjectRotation() const;
 
 };
@@ -4,13 +4,13 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "Kismet/GameplayStaticsTypes.h"
 #include "TeleportComponent.generated.h"
 
 
 class ATeleportVisualizer;
 class AStaticMeshActor;
 class UMotionControllerComponent;
-struct FPredictProjectilePathResult;
 class AStarlightCharacter;
 
 
@@ -41,6 +41,22 @@ protected:
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Teleport")
 	TSubclassOf<ATeleportVisualizer> VisualizerClass;
+
+	/** Arc is predicted again only when launch location moves further than this */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Teleport|Caching", meta = (ClampMin = "0"))
+	float ArcRecomputeDistance = 1.f;
+
+	/** Arc is predicted again only when launch direction turns by more than this angle (degrees) */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Teleport|Caching", meta = (ClampMin = "0"))
+	float ArcRecomputeAngle = 0.5f;
+
+	/** Arc is predicted again at least this often (seconds) so it reacts to moving geometry */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Teleport|Caching", meta = (ClampMin = "0"))
+	float ArcMaxCacheTime = 0.25f;
+
+	/** Arc hit location is projected to navigation again only when it moves further than this */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Teleport|Caching", meta = (ClampMin = "0"))
+	float NavProjectionRecomputeDistance = 5.f;
 	
 private:
 
@@ -57,10 +73,34 @@ private:
 	bool bIsTeleportAxisOverThreshold = false;
 
 	float ProjectileRadius = 50.f;
+
+	FPredictProjectilePathResult CachedPredictResult;
+
+	/** Launch pose the cached arc was predicted from */
+	FVector CachedArcLocation = FVector::ZeroVector;
+	FVector CachedArcDirection = FVector::ZeroVector;
+
+	float CachedArcAge = 0.f;
+	bool bHasCachedArc = false;
+
+	/** Arc hit location which was last projected to navigation */
+	FVector CachedProjectionQuery = FVector::ZeroVector;
+	FVector CachedNavLocation = FVector::ZeroVector;
+	bool bHasProjectionQuery = false;
+	bool bHasNavLocation = false;
 	
 	void StartTeleport();
 	void FinishTeleport();
-	void UpdateTeleport(FPredictProjectilePathResult& OutPredictResult) const;
+
+	void GetLaunchPose(FVector& OutLocation, FVector& OutDirection) const;
+
+	/** Predicts teleport arc if launch pose has changed enough or cached arc is too old. Returns whether it did. */
+	bool UpdateTeleportArc(float DeltaTime);
+
+	/** Projects arc hit location to navigation unless it's close to the last projected one. */
+	void UpdateNavProjection();
+
+	void InvalidateTeleportCache();
 	
 	
 };
@@ -6,6 +6,10 @@
 #include "GameFramework/Actor.h"
 #include "TeleportVisualizer.generated.h"
 
+class UInstancedStaticMeshComponent;
+struct FPredictProjectilePathPointData;
+
+
 UCLASS()
 class STARLIGHT_API ATeleportVisualizer : public AActor
 {
@@ -16,10 +20,36 @@ public:
 	ATeleportVisualizer();
 
 	void UpdateVisualizerLocation(const FVector& NewLocation);
+
+	/** Shows or hides teleport target mesh, arc is not affected. */
+	void SetTargetVisibility(bool bVisible);
+
+	/**
+	 * Draws teleport arc through given path points, one segment instance per pair of consecutive points. Instances
+	 * are reused between updates, they are only added or removed when number of segments changes.
+	 */
+	void UpdateArc(const TArray<FPredictProjectilePathPointData>& PathData);
 	
 protected:
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "StaticMesh")
 	TObjectPtr<UStaticMeshComponent> StaticMeshComponent;
+
+	/** Arc segments in world space, mesh should be aligned with X axis and centered at the origin (engine cube by default) */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Arc")
+	TObjectPtr<UInstancedStaticMeshComponent> ArcSegmentsComponent;
+
+	/** Length of the segment mesh along X axis */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Arc", meta = (ClampMin = "0.01"))
+	float ArcSegmentMeshLength = 100.f;
+
+	/** Scale applied to the segment mesh along Y and Z axes */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Arc", meta = (ClampMin = "0"))
+	float ArcThickness = 0.02f;
+
+private:
+
+	/** Scratch buffer for segment transforms, kept between updates to avoid allocations */
+	TArray<FTransform> ArcSegmentTransforms;
 	
 };
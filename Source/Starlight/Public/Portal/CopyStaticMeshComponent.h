@@ -21,20 +21,40 @@ public:
 
 	/**
 	 * Sets a linked component to which this component will propagate all forces applied to it.
+	 * Pass nullptr to unlink the component before it is linked to another one.
 	 */
 	void SetLinkedComponent(TObjectPtr<UPrimitiveComponent> Component);
+
+	/**
+	 * While the body is driven on physics thread, moving the component only updates its game thread transform and
+	 * doesn't touch the physics body.
+	 */
+	void SetDrivenOnPhysicsThread(bool bDriven);
 	
 	virtual void AddForceAtLocation(FVector Force, FVector Location, FName BoneName) override;
 	virtual void AddImpulseAtLocation(FVector Impulse, FVector Location, FName BoneName) override;
-	void OnPhysicsImpulseApplied(const FVector& Impulse, const FVector& Location);
 	
 protected:
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Portal")
 	TObjectPtr<UPrimitiveComponent> LinkedComponent;
 
+	bool bIsDrivenOnPhysicsThread = false;
+
+protected:
+
+	virtual void OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport) override;
+
 private:
 
 	void PropagateImpulseAtLocation(const FVector& Impulse, const FVector& Location, FName BoneName = NAME_None);
+
+	/**
+	 * Transforms force or impulse applied to this component into linked component's space. Copy can be scaled relative
+	 * to the linked component when portals have different sizes, so the magnitude is adjusted to produce mirrored
+	 * change in velocity on the linked component.
+	 */
+	void TransformToLinkedComponent(const FVector& Vector, const FVector& Location, FVector& OutVector,
+	                                FVector& OutLocation) const;
 	
 };
@@ -13,6 +13,9 @@ class ITeleportable;
 class UBoxComponent;
 class APortalSurface;
 class APortal;
+class UPortalCollisionSubsystem;
+class UPortalTeleportEventSubsystem;
+enum class EPortalCollisionMaskType : uint8;
 
 
 UCLASS()
@@ -25,6 +28,9 @@ public:
 
 	virtual void Tick(float DeltaSeconds) override;
 
+	/** Returns velocity the portal has been moving with since the last frame, e.g. when attached to a platform. */
+	virtual FVector GetVelocity() const override;
+
 	/**
 	 *	Fills out portal data. Must be called immediately after creating a new portal.
 	 *	@param Surface actor the portal is attached to
@@ -46,6 +52,9 @@ public:
 
 	/** Returns rectangle (YZ) space occupied by portal on the surface (in surface local space). */
 	FVector GetExtents() const;
+
+	/** Returns how many times connected portal is larger than this one. */
+	float GetSizeRatio() const;
 	
 	/**
 	 *	Sets render targets for portal
@@ -67,9 +76,35 @@ public:
 	FVector TeleportLocation(const FVector& Location) const;
 	FQuat TeleportRotation(const FQuat& Quat) const;
 	FRotator TeleportRotation(const FRotator& Rotator) const;
-	FVector TeleportVelocity(const FVector& Velocity) const;
+
+	/**
+	 * Transforms linear velocity of an object at the location through the portal, accounting for linear and angular
+	 * velocities and size ratio of both portals.
+	 */
+	FVector TeleportVelocity(const FVector& Velocity, const FVector& Location) const;
+
+	/** Rotates angular velocity (in radians) through the portal, accounting for angular velocities of both portals. */
+	FVector TeleportAngularVelocity(const FVector& AngularVelocity) const;
+
+	/** Velocity of a point at the location which is moving together with the portal */
+	FVector GetVelocityAtLocation(const FVector& Location) const;
 
 	TObjectPtr<ATeleportableCopy> RetrieveCopyForActor(TObjectPtr<AActor> Actor) const;
+
+	/** Returns transform which maps objects in front of this portal to the other side of connected portal. */
+	const FTransform& GetPairTransform() const;
+
+	/** Maps transform of copy's parent through the portal pair, scale is kept as is for actors not scaled by portals. */
+	static FTransform CalculateTransformForCopy(const FTransform& PairTransform, const FTransform& ParentTransform,
+	                                            bool bScaledByPortals);
+
+	/** Maps transforms of copies' parents through the portal pair, spread over worker threads unless forced not to. */
+	static void CalculateTransformsForCopies(const FTransform& PairTransform, TConstArrayView<FTransform> ParentTransforms,
+	                                         TConstArrayView<bool> ParentScaledFlags, TArrayView<FTransform> CopyTransforms,
+	                                         bool bForceSingleThread);
+
+	/** Marks or unmarks component as being in a certain relation to this portal for collision filtering. */
+	void SetCollisionMaskBit(TObjectPtr<UPrimitiveComponent> Component, EPortalCollisionMaskType Type, bool bValue) const;
 	
 protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Portal")
@@ -95,6 +130,8 @@ protected:
 protected:
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 private:
 	UPROPERTY()
 	TObjectPtr<APortalSurface> PortalSurface = nullptr;
@@ -105,6 +142,22 @@ private:
 	FVector LocalCoords;
 	FVector Extents;
 
+	/** Portal transform relative to the surface, used to follow the surface when it moves */
+	FTransform SurfaceRelativeTransform;
+
+	/** Surface transform in the previous frame */
+	FTransform LastSurfaceTransform;
+
+	FVector PortalVelocity = FVector::ZeroVector;
+
+	/** Angular velocity of the portal in radians */
+	FVector PortalAngularVelocity = FVector::ZeroVector;
+
+	/** Transform from this portal's backfacing space to connected portal's world space, includes size ratio */
+	mutable FTransform CachedPairTransform;
+
+	mutable bool bPairTransformDirty = true;
+
 	UPROPERTY()
 	TObjectPtr<UMaterialInstanceDynamic> DynamicInstance = nullptr;
 
@@ -122,7 +175,20 @@ private:
 
 	EPortalType PortalType;
 
-	ECollisionChannel InnerCollisionChannel;
+	UPROPERTY(Transient)
+	TObjectPtr<UPortalCollisionSubsystem> CollisionSubsystem = nullptr;
+
+	/** Bit which this portal occupies in portal collision masks */
+	int32 CollisionIndex = INDEX_NONE;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UPortalTeleportEventSubsystem> TeleportEventSubsystem = nullptr;
+
+	/** Scratch buffers for copy synchronization, kept between frames to avoid allocations */
+	TArray<ATeleportableCopy*> SyncedCopies;
+	TArray<FTransform> SyncedParentTransforms;
+	TArray<bool> SyncedParentScaledFlags;
+	TArray<FTransform> SyncedCopyTransforms;
 	
 private:
 	UFUNCTION()
@@ -153,7 +219,17 @@ private:
 
 	void CreateTeleportableCopy(TObjectPtr<ITeleportable> TeleportingActor);
 	void DeleteTeleportableCopy(int32 ParentObjectId);
+	void ReleaseTeleportableCopy(TObjectPtr<ATeleportableCopy> Copy);
 	FTransform CalculateTransformForCopy(TObjectPtr<const AActor> ParentActor) const;
 
+	/** Computes transforms of all copies from their parents in parallel and then moves copies on game thread. */
+	void SyncCopiesWithParents();
+
 	void UpdateSceneCaptureClipPlane();
+
+	/** Follows portal surface if it has moved since the last frame. */
+	void UpdatePortalTransform(float DeltaSeconds);
+
+	/** Called when either this or connected portal has moved. */
+	void OnPairTransformChanged();
 };
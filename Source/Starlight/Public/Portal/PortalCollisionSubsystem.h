@@ -0,0 +1,221 @@
+﻿// Shadowhoof Games, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chaos/GeometryParticlesfwd.h"
+#include "Chaos/ChaosEngineInterface.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PortalCollisionSubsystem.generated.h"
+
+class APortal;
+class APortalSurface;
+class FPortalCollisionFilterCallback;
+
+
+/** Relation between a physics body and a portal which affects what the body is allowed to collide with. */
+enum class EPortalCollisionMaskType : uint8
+{
+	/** Body is inside portal's inner collision box */
+	Inner,
+
+	/** Body is inside portal's outer collision box */
+	Outer,
+
+	/** Body belongs to a teleportable copy which is sticking out of the portal */
+	Copy
+};
+
+
+/**
+ * Portal bitmasks of a single physics body. Every registered portal owns one bit in each of the masks.
+ */
+struct STARLIGHT_API FPortalCollisionMask
+{
+	uint64 InnerMask = 0;
+	uint64 OuterMask = 0;
+	uint64 CopyMask = 0;
+
+	bool IsEmpty() const;
+
+	uint64& GetMask(EPortalCollisionMaskType Type);
+
+	/**
+	 * Bodies inside a portal only collide with bodies near the same portal. Copies only collide with bodies inside
+	 * the portal they are sticking out of.
+	 */
+	static bool ShouldCollide(const FPortalCollisionMask& First, const FPortalCollisionMask& Second);
+};
+
+
+/** Identifies a group of ignored collision pairs which can be removed later. */
+struct STARLIGHT_API FPortalIgnoreCollisionHandle
+{
+	int32 Id = INDEX_NONE;
+
+	bool IsValid() const;
+};
+
+
+/** Request to start or stop ignoring collisions between two physics bodies. */
+struct FPortalIgnoreCollisionCommand
+{
+	Chaos::FUniqueIdx First;
+	Chaos::FUniqueIdx Second;
+	bool bIgnore = true;
+};
+
+
+/**
+ * Request to link or unlink a copy body with the parent body it mirrors through a portal. Proxies are only read on
+ * physics thread while the link is applied, game thread unlinks before either body is destroyed.
+ */
+struct FPortalCopyLinkCommand
+{
+	Chaos::FUniqueIdx CopyIdx;
+	FPhysicsActorHandle CopyProxy = nullptr;
+	FPhysicsActorHandle ParentProxy = nullptr;
+
+	/** Copy transform is parent transform multiplied by this */
+	FTransform PairTransform;
+
+	bool bRemove = false;
+};
+
+
+/**
+ * Filters physics collisions between bodies based on which portals they are in. Replaces swapping collision object
+ * types on portal overlap so any number of portals can coexist without using up collision channels.
+ * Also owns ignored collision pairs, e.g. between a teleportable and the surface its portal is on, and links between
+ * copies and their parents which are coupled on physics thread.
+ * Mask changes and ignore commands are queued on game thread and sent to physics thread once per frame.
+ */
+UCLASS()
+class STARLIGHT_API UPortalCollisionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static constexpr int32 MaxPortals = 64;
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	/** Assigns a mask bit to the portal. Returns INDEX_NONE if there are no free bits left. */
+	int32 RegisterPortal(TObjectPtr<APortal> Portal);
+
+	/** Frees portal's mask bit and clears it from every body. */
+	void UnregisterPortal(int32 PortalIndex);
+
+	void SetPortalBit(TObjectPtr<UPrimitiveComponent> Component, EPortalCollisionMaskType Type, int32 PortalIndex, bool bValue);
+
+	/** Removes all portal bits from the body, e.g. when it is about to be destroyed. */
+	void ClearMask(TObjectPtr<UPrimitiveComponent> Component);
+
+	/**
+	 * Disables collision between component and each of other components, both physics and component movement.
+	 * Physics part is applied at the start of the next physics step.
+	 * @return Handle which has to be passed to RemoveIgnoreCollision to restore collision
+	 */
+	FPortalIgnoreCollisionHandle AddIgnoreCollision(TObjectPtr<UPrimitiveComponent> Component,
+	                                                const TArray<TObjectPtr<UPrimitiveComponent>>& OtherComponents);
+
+	/** Restores collision disabled by AddIgnoreCollision and invalidates the handle. */
+	void RemoveIgnoreCollision(FPortalIgnoreCollisionHandle& Handle);
+
+	/**
+	 * Disables collision between component and the portal surface it is passing through. Does nothing if collision
+	 * with that surface is already disabled for the component.
+	 */
+	void IgnorePortalSurface(TObjectPtr<UPrimitiveComponent> Component, TObjectPtr<APortalSurface> PortalSurface);
+
+	/** Restores collision disabled by IgnorePortalSurface. */
+	void RestorePortalSurface(TObjectPtr<UPrimitiveComponent> Component, TObjectPtr<APortalSurface> PortalSurface);
+
+	/**
+	 * Links copy body to parent body. On physics thread copy follows parent every substep and contacts with the copy
+	 * push the parent in the same substep, so game thread shouldn't move the copy body while it is linked. Calling it
+	 * again for the same copy updates the pair transform. Link is removed when physics body of either component is
+	 * destroyed.
+	 * @param PairTransform copy transform is parent transform multiplied by this
+	 * @return false if either of the components has no physics body to link
+	 */
+	bool SetCopyLink(TObjectPtr<UPrimitiveComponent> CopyComponent, TObjectPtr<UPrimitiveComponent> ParentComponent,
+	                 const FTransform& PairTransform);
+
+	void RemoveCopyLink(TObjectPtr<UPrimitiveComponent> CopyComponent);
+
+protected:
+
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+
+	TMap<TWeakObjectPtr<UPrimitiveComponent>, FPortalCollisionMask> BodyMasks;
+
+	uint64 UsedPortalBits = 0;
+
+	FPortalCollisionFilterCallback* FilterCallback = nullptr;
+
+	/** Latest mask of every body changed this frame, waiting to be sent to physics thread */
+	TMap<Chaos::FUniqueIdx, FPortalCollisionMask> PendingMaskUpdates;
+
+	struct FIgnoreCollisionEntry
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		TArray<TWeakObjectPtr<UPrimitiveComponent>> OtherComponents;
+		TArray<FPortalIgnoreCollisionCommand> PhysicsPairs;
+	};
+
+	TMap<int32, FIgnoreCollisionEntry> IgnoreEntries;
+
+	int32 NextIgnoreHandleId = 0;
+
+	/** Ignored collisions of bodies with portal surfaces they are currently passing through */
+	TMap<TWeakObjectPtr<UPrimitiveComponent>, TMap<TWeakObjectPtr<APortalSurface>, FPortalIgnoreCollisionHandle>> SurfaceIgnoreHandles;
+
+	TArray<FPortalIgnoreCollisionCommand> PendingIgnoreCommands;
+
+	TArray<FPortalCopyLinkCommand> PendingCopyLinkCommands;
+
+	struct FCopyLinkEntry
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Copy;
+		TWeakObjectPtr<UPrimitiveComponent> Parent;
+		FTransform PairTransform;
+		Chaos::FUniqueIdx CopyIdx;
+	};
+
+	/**
+	 * Linked copies and their parents, physics thread has to be told about the link going away before either body
+	 * does. Links are sent again when the bodies are recreated
+	 */
+	TArray<FCopyLinkEntry> CopyLinks;
+
+	/** Gravity physics thread has last been sent, copies are moved to where gravity is going to take their parents */
+	TOptional<float> SentGravityZ;
+
+private:
+
+	void PushMask(TObjectPtr<UPrimitiveComponent> Component, const FPortalCollisionMask& Mask);
+
+	void FlushPhysicsCommands();
+
+	void PushCopyLink(const FCopyLinkEntry& Entry);
+
+	/** Sends removal of the link to physics thread right away, the body may be destroyed before the next tick. */
+	void PushCopyUnlink(const FCopyLinkEntry& Entry);
+
+	/** Unlinks and stops watching components which are no longer linked. */
+	void RemoveCopyLinkAt(int32 Index);
+
+	UFUNCTION()
+	void OnLinkedBodyPhysicsStateChanged(UPrimitiveComponent* ChangedComponent, EComponentPhysicsStateChange StateChange);
+
+};
@@ -4,6 +4,8 @@ class APortal;
 	
 DECLARE_LOG_CATEGORY_EXTERN(LogPortal, Log, All);
 
+DECLARE_STATS_GROUP(TEXT("Portal"), STATGROUP_Portal, STATCAT_Advanced);
+
 UENUM(BlueprintType)
 enum class EPortalType : uint8
 {
@@ -21,6 +23,12 @@ namespace PortalConstants
 	const FVector InnerCollisionExtent = {50.f, 90.f, 125.f};
 	const FVector OuterCollisionExtent = {150.f, 270.f, 375.f};
 
+	/* character moves crossing a portal are stopped this far behind portal plane so the crossing counts as a teleport */
+	const float MoveSplitPlaneOffset = 0.1f;
+
+	/* number of parked teleportable copies created for each copy class on world begin play */
+	const int32 CopyPoolPrewarmCount = 2;
+
 	/* materials */
 	
 	const FName CanBeCulledParam = "CanBeCulled";
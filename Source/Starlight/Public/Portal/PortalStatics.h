@@ -10,6 +10,7 @@
 #include "PortalStatics.generated.h"
 
 class APortal;
+class UMeshComponent;
 
 
 USTRUCT()
@@ -72,31 +73,45 @@ public:
 	                                   FCollisionQueryParams QueryParams = FCollisionQueryParams::DefaultQueryParam,
 	                                   FCollisionResponseParams ResponseParams = FCollisionResponseParams::DefaultResponseParam);
 
-	static EPortalType GetOtherPortalType(EPortalType PortalType);
-
 	/**
-	 * Returns object type of actor copy which will be created whenever a teleportable actor comes in contact
-	 * with portal of provided type.  
+	 * @brief Finds objects overlapping the part of a sphere which reaches through a portal. The query is done on the
+	 * other side of connected portal, with the sphere scaled by portals' size ratio.
+	 * @param World World in which to query
+	 * @param OutOverlaps Overlaps found on the other side of connected portal
+	 * @param Portal Portal the sphere might be reaching through
+	 * @param Center Center of the sphere in front of the portal
+	 * @param Radius Radius of the sphere
+	 * @param ObjectQueryParams Object types to look for
+	 * @param QueryParams Collision query params
+	 * @return Whether anything was found. Nothing is queried if the sphere doesn't reach portal rectangle, and objects
+	 * behind connected portal's plane are left out.
 	 */
-	static ECollisionChannel GetCopyObjectType(EPortalType PortalType);
+	static bool OverlapSphereThroughPortal(TObjectPtr<UWorld> World,
+	                                       TArray<FOverlapResult>& OutOverlaps,
+	                                       TObjectPtr<const APortal> Portal,
+	                                       const FVector& Center,
+	                                       float Radius,
+	                                       const FCollisionObjectQueryParams& ObjectQueryParams,
+	                                       FCollisionQueryParams QueryParams = FCollisionQueryParams::DefaultQueryParam);
+
+	static EPortalType GetOtherPortalType(EPortalType PortalType);
 
 	/**
-	 * Returns object type of actor copy which will be created whenever a teleportable actor comes in contact
-	 * with portal of opposing type to the one provided.  
+	 * Puts a dynamic instance of the first material in the component, which receives the cull plane. Instance already
+	 * in that slot is kept if it was made from the material the component's mesh has there, so reused copies don't
+	 * create a new one every time.
 	 */
-	static ECollisionChannel GetOpposingCopyObjectType(EPortalType PortalType);
+	static void CreateCullPlaneMaterial(TObjectPtr<UMeshComponent> Component);
 
 	/**
-	 * Returns object type that a teleportable object would get on overlap with this portal type. Does not take into
-	 * account if object is already overlapping with another portal.
+	 * Sets cull plane of the component's dynamic material instance, parts of the component behind the plane are not
+	 * rendered. Parameters which haven't changed aren't sent to the renderer again.
 	 */
-	static ECollisionChannel GetInnerObjectTypeForPortalType(EPortalType PortalType);
-	
-	/* Returns object type appropriate for a teleportable object of provided type when it begins overlapping with a particular portal type. */
-	static ECollisionChannel GetObjectTypeOnOverlapBegin(TObjectPtr<ITeleportable> Teleportable, EPortalType PortalType);
+	static void SetCullPlane(TObjectPtr<UPrimitiveComponent> Component, const FVector& CullPlaneCenter,
+	                         const FVector& CullPlaneNormal);
 
-	/* Returns object type appropriate for a teleportable object of provided type when it stops overlapping with a particular portal type. */
-	static ECollisionChannel GetObjectTypeOnOverlapEnd(TObjectPtr<ITeleportable> Teleportable, EPortalType PortalType);
+	/** Disables culling set up by SetCullPlane. */
+	static void ClearCullPlane(TObjectPtr<UPrimitiveComponent> Component);
 
 	/**
 	 * @brief Checks whether component will be inside blocking geometry at provided location and rotation. Calculates
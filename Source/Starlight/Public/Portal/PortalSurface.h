@@ -19,6 +19,9 @@ public:
 
 	bool CanFitPortal() const;
 
+	/** Returns scale of portals placed on this surface relative to the default portal size. */
+	float GetPortalScale() const;
+
 	bool GetPortalLocation(const FHitResult& HitResult, FVector& OutLocation, FVector& OutLocalCoords, FVector& OutExtents, FRotator& OutRotation);
 	
 	/**
@@ -56,6 +59,13 @@ protected:
 	 * the portal gun will try to place the portal in the center. */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Portal")
 	bool bPortalOnlyInCenter = false;
+
+	/**
+	 * Scale of portals placed on this surface relative to the default portal size. Objects passing between portals
+	 * of different sizes are scaled by the ratio of their sizes.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Portal", meta = (ClampMin = "0.1"))
+	float PortalScale = 1.f;
 	
 	FVector Size;
 	FVector Extents;
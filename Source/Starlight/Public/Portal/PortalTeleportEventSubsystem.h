@@ -0,0 +1,79 @@
+﻿// Shadowhoof Games, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "PortalTeleportEventSubsystem.generated.h"
+
+class APortal;
+
+
+/** Actor teleported by a portal. */
+struct FPortalTeleportEvent
+{
+	TWeakObjectPtr<AActor> Actor;
+
+	/** Portal that actor was teleported from */
+	TWeakObjectPtr<APortal> SourcePortal;
+
+	/** Portal that actor was teleported to */
+	TWeakObjectPtr<APortal> TargetPortal;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FPortalTeleportEventDelegate, const FPortalTeleportEvent& /* Event */)
+
+
+/**
+ * Collects teleports done by portals during the frame and dispatches them in one batch to listeners subscribed to
+ * the teleported actor. Events are dispatched in the order they happened, at the end of the frame or earlier if
+ * somebody who needs up to date state flushes them.
+ */
+UCLASS()
+class STARLIGHT_API UPortalTeleportEventSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	/** Queues teleport event, actor is expected to be already teleported. */
+	void QueueTeleportEvent(TObjectPtr<AActor> Actor, TObjectPtr<APortal> SourcePortal, TObjectPtr<APortal> TargetPortal);
+
+	/** Subscribes to teleports of the actor. Returned handle has to be passed to Unsubscribe. */
+	FDelegateHandle Subscribe(TObjectPtr<const AActor> Actor, FPortalTeleportEventDelegate::FDelegate&& Delegate);
+
+	/** Removes subscription and resets the handle. */
+	void Unsubscribe(TObjectPtr<const AActor> Actor, FDelegateHandle& Handle);
+
+	/** Dispatches all queued events including the ones queued by listeners during dispatch. */
+	void DispatchPendingEvents();
+
+protected:
+
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+
+	TMap<TObjectKey<AActor>, FPortalTeleportEventDelegate> Listeners;
+
+	TArray<FPortalTeleportEvent> PendingEvents;
+
+	/** Events of the batch being dispatched. Swapped with pending events so that listeners can queue new ones. */
+	TArray<FPortalTeleportEvent> DispatchedEvents;
+
+	bool bIsDispatching = false;
+
+	/** Whether some listeners were left without subscribers during dispatch and have to be removed afterwards */
+	bool bHasUnboundListeners = false;
+
+private:
+
+	void RemoveUnboundListeners();
+};
@@ -20,6 +20,8 @@ public:
 
 	virtual void Initialize(TObjectPtr<ITeleportable> InParent, TObjectPtr<APortal> InOwnerPortal) override;
 
+	virtual void Park() override;
+
 	virtual bool IsHiddenInPortal() const override;
 	
 protected:
@@ -33,4 +35,15 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Portal")
 	TWeakObjectPtr<USkeletalMeshComponent> ParentMeshComponent;
 
+	/**
+	 * Copy follows pose already evaluated by the parent mesh instead of running animation on its own. When disabled,
+	 * copy runs parent's animation blueprint with update rate optimizations.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Portal")
+	bool bUseLeaderPose = true;
+
+	/** Only used without leader pose. Copy skips evaluating its pose when it's not rendered. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Portal", meta = (EditCondition = "!bUseLeaderPose"))
+	EVisibilityBasedAnimTickOption AnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+
 };
@@ -21,13 +21,13 @@ public:
 
 	virtual void Initialize(TObjectPtr<ITeleportable> InParent, TObjectPtr<APortal> InOwnerPortal) override;
 
-	virtual void ResetVelocity() override;
+	virtual void Park() override;
 
-	virtual void DispatchPhysicsCollisionHit(const FRigidBodyCollisionInfo& MyInfo,
-	                                         const FRigidBodyCollisionInfo& OtherInfo,
-	                                         const FCollisionImpactData& RigidCollisionData) override;
+	virtual void OnPortalMoved() override;
 
 protected:
+
+	virtual void ClearPortalCollision() override;
 	
 	UPROPERTY()
 	TObjectPtr<UCopyStaticMeshComponent> StaticMeshComponent;
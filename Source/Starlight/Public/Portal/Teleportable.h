@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "UObject/Interface.h"
+#include "PortalCollisionSubsystem.h"
 #include "Teleportable.generated.h"
 
 class APortalSurface;
@@ -58,12 +59,10 @@ public:
 	virtual TObjectPtr<UPrimitiveComponent> GetCollisionComponent() const;
 
 	virtual FVector GetTeleportableObjectLocation() const;
+
+	/** Whether object is resized when passing between portals of different sizes. */
+	virtual bool IsScaledByPortals() const;
 	
 	virtual void GetTeleportVelocity(FVector& LinearVelocity, FVector& AngularVelocity) const;
 	virtual void SetTeleportVelocity(const FVector& LinearVelocity, const FVector& AngularVelocity);
-
-	virtual void OnTeleportableMoved();
-
-	/* Returns base object type of a teleportable object so it can be restored when object leaves portal inner collision box. */
-	virtual ECollisionChannel GetTeleportableBaseObjectType();
 };
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "PortalCollisionSubsystem.h"
 #include "Teleportable.h"
 #include "GameFramework/Actor.h"
 #include "TeleportableCopy.generated.h"
@@ -21,29 +22,44 @@ public:
 	ATeleportableCopy();
 
 	/**
-	 * Initializes created teleportable actor copy
+	 * Initializes created or reused teleportable actor copy
 	 * @param InParent Actor that served as a base for this copy
 	 * @param InOwnerPortal Portal that created and owns this copy
 	 */
 	virtual void Initialize(TObjectPtr<ITeleportable> InParent, TObjectPtr<APortal> InOwnerPortal);
 
 	/**
-	 * Sets up culling parameters for dynamic materials
+	 * Clears everything set up by Initialize and disables physics and rendering so the copy can wait in the pool
+	 * until it is initialized again.
+	 */
+	virtual void Park();
+
+	/**
+	 * Sets up cull plane for the copy's mesh
 	 */
 	void UpdateCullingParams(const FVector& CullPlaneCenter, const FVector& CullPlaneNormal);
 	
 	virtual TObjectPtr<AActor> GetParent() const;
 
-	virtual void ResetVelocity();
+	/**
+	 * Moves copy to the transform mirroring its parent. Physics bodies of copies are kinematic so this sets their
+	 * kinematic target and solver derives their velocity from the movement, unless the body is linked to its parent
+	 * on physics thread and is only moved there.
+	 */
+	void FollowParent(const FTransform& NewTransform);
 
 	TWeakObjectPtr<APortal> GetOwnerPortal() const;
 
 	virtual bool IsHiddenInPortal() const;
+
+	/** Called when either of the portals the copy is passing through has moved. */
+	virtual void OnPortalMoved();
 	
 protected:
 
+	/** Mesh which is culled by the portal plane */
 	UPROPERTY()
-	TArray<TObjectPtr<UMaterialInstanceDynamic>> DynamicMaterialInstances;
+	TObjectPtr<UMeshComponent> CulledMeshComponent;
 
 	UPROPERTY()
 	TObjectPtr<AActor> ParentActor;
@@ -51,10 +67,23 @@ protected:
 	UPROPERTY()
 	TWeakObjectPtr<APortal> OwnerPortal;
 
+	FPortalIgnoreCollisionHandle PortalSurfaceIgnoreHandle;
+
 protected:
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Releases portal collision filtering and ignored collisions set up for this copy. */
+	virtual void ClearPortalCollision();
+
 	void DisableCollisionWithPortal(TObjectPtr<UPrimitiveComponent> CollisionComponent);
+
+	/**
+	 * Puts copy's collision component on the copy object type and takes over parent's responses, except for trace
+	 * channels of gameplay queries which should only ever hit the parent.
+	 */
+	void SetupCopyCollision(TObjectPtr<UPrimitiveComponent> CollisionComponent, TObjectPtr<const UPrimitiveComponent> ParentCollisionComponent);
 	
-	void CreateDynamicInstances(TObjectPtr<UMeshComponent> MeshComponent);
+	void SetCulledMeshComponent(TObjectPtr<UMeshComponent> MeshComponent);
 	
 };
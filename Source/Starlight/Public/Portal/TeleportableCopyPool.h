@@ -0,0 +1,60 @@
+﻿// Shadowhoof Games, 2022
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TeleportableCopyPool.generated.h"
+
+class ATeleportableCopy;
+
+
+USTRUCT()
+struct STARLIGHT_API FTeleportableCopyPoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TObjectPtr<ATeleportableCopy>> Copies;
+};
+
+
+/**
+ * Keeps released teleportable copies parked with physics and rendering disabled so objects jittering at a portal
+ * boundary don't spawn and destroy a copy every few frames. Copies are pooled per class and pre-warmed on world
+ * begin play for every teleportable present in the level.
+ */
+UCLASS()
+class STARLIGHT_API UTeleportableCopyPool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** Returns a parked copy of the provided class or spawns a new one. Copy has to be initialized by the caller. */
+	TObjectPtr<ATeleportableCopy> AcquireCopy(TSubclassOf<ATeleportableCopy> CopyClass, const FTransform& Transform);
+
+	/** Parks the copy until it is acquired again, or destroys it if enough copies of its class are parked already. */
+	void ReleaseCopy(TObjectPtr<ATeleportableCopy> Copy);
+
+	/** Makes sure at least Count parked copies of the provided class are available, up to the parked copy limit. */
+	void Prewarm(TSubclassOf<ATeleportableCopy> CopyClass, int32 Count);
+
+protected:
+
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+
+	UPROPERTY()
+	TMap<TSubclassOf<ATeleportableCopy>, FTeleportableCopyPoolBucket> ParkedCopies;
+
+private:
+
+	TObjectPtr<ATeleportableCopy> SpawnCopy(TSubclassOf<ATeleportableCopy> CopyClass, const FTransform& Transform) const;
+
+	void UpdatePooledCopyStat() const;
+
+};
@@ -7,12 +7,6 @@
 #include "StarlightStatics.generated.h"
 
 
-namespace Chaos
-{
-	class FIgnoreCollisionManager;
-}
-
-
 /**
  * 
  */
@@ -26,14 +20,6 @@ public:
 
 	// Physics begin
 
-	static void EnableCollisionBetween(TObjectPtr<UPrimitiveComponent> First, TObjectPtr<UPrimitiveComponent> Second);
-	static void DisableCollisionBetween(TObjectPtr<UPrimitiveComponent> First, TObjectPtr<UPrimitiveComponent> Second);
-
-	static bool IsPhysicsCollisionIgnored(TObjectPtr<UPrimitiveComponent> First,
-	                                      TObjectPtr<UPrimitiveComponent> Second);
-
-	static Chaos::FIgnoreCollisionManager& GetIgnoreCollisionManager(TObjectPtr<UPrimitiveComponent> Component);
-
 	static Chaos::FUniqueIdx GetPhysicsHandleID(TObjectPtr<UPrimitiveComponent> Component);
 
 	// Physics end